@@ -272,6 +272,23 @@ void USentryBlueprintLibrary::SetUserConsent(ESentryConsent Consent)
 }
 
 
+// Release health
+
+void USentryBlueprintLibrary::StartSession()
+{
+#if SENTRY_HAVE_PLATFORM
+	sentry_start_session();
+#endif
+}
+
+void USentryBlueprintLibrary::EndSession()
+{
+#if SENTRY_HAVE_PLATFORM
+	sentry_end_session();
+#endif
+}
+
+
 // User information
 
 void USentryBlueprintLibrary::SetUser(const FString& id, const FString& username, const FString& email)
@@ -294,6 +311,8 @@ void USentryBlueprintLibrary::SetUser(const FString& id, const FString& username
 	}
 	sentry_set_user(user);
 #endif
+	// only an id set by the game, account names like "root" or "steam" are the same on many machines
+	FSentryTransaction::SetSamplingUser(id);
 }
 
 void USentryBlueprintLibrary::ClearUser()
@@ -301,6 +320,7 @@ void USentryBlueprintLibrary::ClearUser()
 #if SENTRY_HAVE_PLATFORM
 	sentry_remove_user();
 #endif
+	FSentryTransaction::SetSamplingUser(FString());
 }
 
 
@@ -490,3 +510,89 @@ sentry_value_t BreadCrumb(ESentryBreadcrumbType type, const FString& message,
 }
 
 #endif // SENTRY_HAVE_PLATFORM
+
+
+// Tracing
+
+USentryTransaction* USentryBlueprintLibrary::StartTransaction(const FString& Name, const FString& Operation)
+{
+	USentryTransaction* Transaction = NewObject<USentryTransaction>();
+	Transaction->Transaction = FSentryTransaction::Start(Name, Operation);
+	return Transaction;
+}
+
+bool USentryTransaction::IsRecording() const
+{
+	return Transaction.IsValid();
+}
+
+USentrySpan* USentryTransaction::StartChild(const FString& Operation, const FString& Description)
+{
+	USentrySpan* Span = NewObject<USentrySpan>();
+	Span->Span = Transaction.StartChild(Operation, Description);
+	return Span;
+}
+
+void USentryTransaction::SetTag(const FString& Key, const FString& Value)
+{
+	Transaction.SetTag(Key, Value);
+}
+
+void USentryTransaction::SetData(const FString& Key, const FString& Value)
+{
+	Transaction.SetData(Key, Value);
+}
+
+void USentryTransaction::SetStatus(ESentrySpanStatus Status)
+{
+	Transaction.SetStatus(Status);
+}
+
+void USentryTransaction::MakeCurrent()
+{
+	Transaction.MakeCurrent();
+}
+
+void USentryTransaction::Finish()
+{
+	Transaction.Finish();
+}
+
+void USentryTransaction::BeginDestroy()
+{
+	Transaction.Discard();
+	Super::BeginDestroy();
+}
+
+USentrySpan* USentrySpan::StartChild(const FString& Operation, const FString& Description)
+{
+	USentrySpan* Child = NewObject<USentrySpan>();
+	Child->Span = Span.StartChild(Operation, Description);
+	return Child;
+}
+
+void USentrySpan::SetTag(const FString& Key, const FString& Value)
+{
+	Span.SetTag(Key, Value);
+}
+
+void USentrySpan::SetData(const FString& Key, const FString& Value)
+{
+	Span.SetData(Key, Value);
+}
+
+void USentrySpan::SetStatus(ESentrySpanStatus Status)
+{
+	Span.SetStatus(Status);
+}
+
+void USentrySpan::Finish()
+{
+	Span.Finish();
+}
+
+void USentrySpan::BeginDestroy()
+{
+	Span.Discard();
+	Super::BeginDestroy();
+}
@@ -0,0 +1,174 @@
+#include "SentryAsyncLoadTracker.h"
+#include "SentryAsyncLoading.h"
+#include "SentryClientModule.h"
+#include "SentryTracing.h"
+
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+
+int32 FSentryAsyncLoading::LoadPackageAsync(const FString& Name, FLoadPackageAsyncDelegate CompletionDelegate, TAsyncLoadPriority Priority)
+{
+	const double Start = FPlatformTime::Seconds();
+	return ::LoadPackageAsync(Name, FLoadPackageAsyncDelegate::CreateLambda(
+		[Start, CompletionDelegate](const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result)
+		{
+			if (Result == EAsyncLoadingResult::Succeeded)
+			{
+				RecordLoad(PackageName.ToString(), FPlatformTime::Seconds() - Start);
+			}
+			CompletionDelegate.ExecuteIfBound(PackageName, Package, Result);
+		}), Priority);
+}
+
+void FSentryAsyncLoading::RecordLoad(const FString& Package, double Seconds)
+{
+#if SENTRY_HAVE_PLATFORM
+	FSentryAsyncLoadTracker::RecordLoad(Package, Seconds);
+#endif
+}
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentryAsyncLoadTracker* FSentryAsyncLoadTracker::Active = nullptr;
+FCriticalSection FSentryAsyncLoadTracker::Lock;
+
+FSentryAsyncLoadTracker::FSentryAsyncLoadTracker()
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	Threshold = USentryClientConfig::GetConfigFloat(TEXT("ASYNC_LOAD_THRESHOLD"), Config->AsyncLoadThreshold) / 1000.0;
+	Interval = FMath::Max(10.0f, USentryClientConfig::GetConfigFloat(TEXT("ASYNC_LOAD_REPORT_INTERVAL"), Config->AsyncLoadReportInterval));
+
+	Slowest.Reserve(MaxSlowest);
+	IntervalStart = FPlatformTime::Seconds();
+
+	FScopeLock ScopeLock(&Lock);
+	Active = this;
+}
+
+FSentryAsyncLoadTracker::~FSentryAsyncLoadTracker()
+{
+	FScopeLock ScopeLock(&Lock);
+	Active = nullptr;
+}
+
+void FSentryAsyncLoadTracker::RecordLoad(const FString& Package, double Seconds)
+{
+	bool bSlow = false;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (!Active)
+		{
+			return;
+		}
+		Active->Record(Package, Seconds);
+		bSlow = Seconds >= Active->Threshold;
+	}
+	if (bSlow)
+	{
+		FSentryTransaction::AddCurrentSpan(TEXT("package.load.async"), Package, Seconds);
+	}
+}
+
+void FSentryAsyncLoadTracker::Record(const FString& Package, double Seconds)
+{
+	LoadTimes.Record((uint64)(Seconds * 1000000.0));
+	if (Seconds < Threshold)
+	{
+		return;
+	}
+	SlowLoads++;
+
+	// a package already in the list keeps its slowest load, else it replaces the fastest
+	int32 Fastest = INDEX_NONE;
+	for (int32 i = 0; i < Slowest.Num(); i++)
+	{
+		FSlowLoad& Load = Slowest[i];
+		if (Load.Package == Package)
+		{
+			Load.Seconds = FMath::Max(Load.Seconds, Seconds);
+			Load.Count++;
+			return;
+		}
+		if (Fastest == INDEX_NONE || Load.Seconds < Slowest[Fastest].Seconds)
+		{
+			Fastest = i;
+		}
+	}
+	if (Slowest.Num() < MaxSlowest)
+	{
+		Slowest.Add(FSlowLoad{ Package, Seconds, 1 });
+	}
+	else if (Seconds > Slowest[Fastest].Seconds)
+	{
+		Slowest[Fastest] = FSlowLoad{ Package, Seconds, 1 };
+	}
+}
+
+void FSentryAsyncLoadTracker::Tick()
+{
+	const double Elapsed = FPlatformTime::Seconds() - IntervalStart;
+	if (Elapsed >= Interval)
+	{
+		Report(Elapsed);
+		IntervalStart = FPlatformTime::Seconds();
+	}
+}
+
+void FSentryAsyncLoadTracker::Report(double Elapsed)
+{
+	sentry_value_t stats = sentry_value_new_object();
+	sentry_value_t slowest = sentry_value_new_list();
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (LoadTimes.GetCount() == 0)
+		{
+			sentry_value_decref(stats);
+			sentry_value_decref(slowest);
+			return;
+		}
+		sentry_value_set_by_key(stats, "type", sentry_value_new_string("async_loading"));
+		sentry_value_set_by_key(stats, "loads", sentry_value_new_int32((int32_t)LoadTimes.GetCount()));
+		sentry_value_set_by_key(stats, "slow_loads", sentry_value_new_int32((int32_t)SlowLoads));
+		sentry_value_set_by_key(stats, "seconds", sentry_value_new_double(Elapsed));
+		sentry_value_set_by_key(stats, "mean_ms", sentry_value_new_double(LoadTimes.GetMean() / 1000.0));
+		sentry_value_set_by_key(stats, "p50_ms", sentry_value_new_double(LoadTimes.GetPercentile(0.50) / 1000.0));
+		sentry_value_set_by_key(stats, "p95_ms", sentry_value_new_double(LoadTimes.GetPercentile(0.95) / 1000.0));
+		sentry_value_set_by_key(stats, "p99_ms", sentry_value_new_double(LoadTimes.GetPercentile(0.99) / 1000.0));
+		sentry_value_set_by_key(stats, "max_ms", sentry_value_new_double(LoadTimes.GetMax() / 1000.0));
+		sentry_value_set_by_key(stats, "threshold_ms", sentry_value_new_double(Threshold * 1000.0));
+
+		Slowest.Sort([](const FSlowLoad& A, const FSlowLoad& B) { return A.Seconds > B.Seconds; });
+		for (const FSlowLoad& Load : Slowest)
+		{
+			sentry_value_t load = sentry_value_new_object();
+			sentry_value_set_by_key(load, "package", sentry_value_new_string(TCHAR_TO_UTF8(*Load.Package)));
+			sentry_value_set_by_key(load, "max_ms", sentry_value_new_double(Load.Seconds * 1000.0));
+			sentry_value_set_by_key(load, "count", sentry_value_new_int32((int32_t)Load.Count));
+			sentry_value_append(slowest, load);
+		}
+
+		LoadTimes.Reset();
+		SlowLoads = 0;
+		Slowest.Reset();
+	}
+
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_INFO, "sentry.loading", "Async load report");
+
+	sentry_value_t contexts = sentry_value_new_object();
+	sentry_value_set_by_key(contexts, "async_loading", stats);
+	sentry_value_set_by_key(event, "contexts", contexts);
+
+	sentry_value_t extra = sentry_value_new_object();
+	sentry_value_set_by_key(extra, "slowest_packages", slowest);
+	sentry_value_set_by_key(event, "extra", extra);
+
+	sentry_value_t fingerprint = sentry_value_new_list();
+	sentry_value_append(fingerprint, sentry_value_new_string("async-load-report"));
+	sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+	sentry_capture_event(event);
+}
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "SentryHistogram.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+// Collects the load times of async package loads (see FSentryAsyncLoading) in a histogram,
+// and keeps the slowest packages in a fixed number of entries, so that streaming a large
+// world doesn't grow it.  Loads over the threshold become spans of the current transaction,
+// e.g. a level load.  An "Async load report" is sent periodically.
+class FSentryAsyncLoadTracker
+{
+public:
+	FSentryAsyncLoadTracker();
+	~FSentryAsyncLoadTracker();
+
+	// Record a finished load, if the tracker is running.  Thread safe.
+	static void RecordLoad(const FString& Package, double Seconds);
+
+	// Call on the game thread, once per frame
+	void Tick();
+
+private:
+	struct FSlowLoad
+	{
+		FString Package;
+		double Seconds;
+		uint32 Count;
+	};
+
+	// slowest packages kept per report
+	static constexpr int32 MaxSlowest = 20;
+
+	void Record(const FString& Package, double Seconds);
+	void Report(double Elapsed);
+
+	// the tracker which is running, protected by Lock along with the statistics
+	static FSentryAsyncLoadTracker* Active;
+	static FCriticalSection Lock;
+
+	// configuration
+	double Threshold = 0.1;
+	double Interval = 300.0;
+
+	// load times in microseconds
+	FSentryHistogram LoadTimes;
+	uint32 SlowLoads = 0;
+	// unordered, at most MaxSlowest
+	TArray<FSlowLoad> Slowest;
+	double IntervalStart = 0.0;
+};
+
+#endif
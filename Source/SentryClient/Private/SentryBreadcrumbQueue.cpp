@@ -0,0 +1,119 @@
+#include "SentryBreadcrumbQueue.h"
+#include "SentryClientModule.h"
+
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+std::atomic<FSentryBreadcrumbQueue*> FSentryBreadcrumbQueue::Active{ nullptr };
+std::atomic<int32> FSentryBreadcrumbQueue::Writers{ 0 };
+
+FSentryBreadcrumbQueue::FSentryBreadcrumbQueue(int32 InIntervalMs)
+	: IntervalMs((uint32)FMath::Max(1, InIntervalMs))
+{
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("SentryBreadcrumbs"), 64 * 1024, TPri_BelowNormal);
+	Active = this;
+}
+
+FSentryBreadcrumbQueue::~FSentryBreadcrumbQueue()
+{
+	// A caller registers before it loads the pointer, so once it is cleared, only the callers
+	// counted here can still be adding
+	Active = nullptr;
+	while (Writers.load() > 0)
+	{
+		FPlatformProcess::YieldThread();
+	}
+	// Kill() calls Stop() and waits for Run() to return
+	Thread->Kill(true);
+	delete Thread;
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+
+	Flush();
+	UE_LOG(LogSentryClient, Log, TEXT("Breadcrumbs: %llu logged, %llu written in %llu flushes"), NumAdded, NumWritten, NumFlushes);
+}
+
+bool FSentryBreadcrumbQueue::AddActive(sentry_value_t Breadcrumb)
+{
+	Writers.fetch_add(1);
+	FSentryBreadcrumbQueue* Queue = Active.load();
+	if (Queue)
+	{
+		Queue->Add(Breadcrumb);
+	}
+	Writers.fetch_sub(1);
+	return Queue != nullptr;
+}
+
+void FSentryBreadcrumbQueue::Add(sentry_value_t Breadcrumb)
+{
+	FScopeLock ScopeLock(&Lock);
+	NumAdded++;
+	if (Queued.Num() >= MaxBreadcrumbs)
+	{
+		// would be pushed out of sentry's ring by the newer ones anyway
+		sentry_value_decref(Queued[0]);
+		Queued.RemoveAt(0, 1, false);
+	}
+	Queued.Add(Breadcrumb);
+}
+
+void FSentryBreadcrumbQueue::Flush()
+{
+	TArray<sentry_value_t> Batch;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (Queued.Num() == 0)
+		{
+			return;
+		}
+		Swap(Batch, Queued);
+		NumWritten += Batch.Num();
+		NumFlushes++;
+	}
+	for (sentry_value_t Breadcrumb : Batch)
+	{
+		sentry_add_breadcrumb(Breadcrumb);
+	}
+}
+
+void FSentryBreadcrumbQueue::FlushOnCrash()
+{
+	// don't block on the lock, the crash may have happened while holding it
+	if (!Lock.TryLock())
+	{
+		return;
+	}
+	TArray<sentry_value_t> Batch;
+	Swap(Batch, Queued);
+	Lock.Unlock();
+
+	// with crashpad each one rewrites the scope file, which the handler reads after the callback
+	for (sentry_value_t Breadcrumb : Batch)
+	{
+		sentry_add_breadcrumb(Breadcrumb);
+	}
+}
+
+uint32 FSentryBreadcrumbQueue::Run()
+{
+	while (!bStopping)
+	{
+		WakeEvent->Wait(IntervalMs);
+		Flush();
+	}
+	return 0;
+}
+
+void FSentryBreadcrumbQueue::Stop()
+{
+	bStopping = true;
+	WakeEvent->Trigger();
+}
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/Runnable.h"
+
+#include <atomic>
+
+#if SENTRY_HAVE_PLATFORM
+
+class FRunnableThread;
+class FEvent;
+
+// Collects log breadcrumbs and hands them to sentry in batches from a background thread.
+// With the crashpad backend, sentry-native writes the breadcrumbs to disk for every
+// sentry_add_breadcrumb, so that the handler can pick them up.  Queueing moves that I/O
+// off the logging thread, and breadcrumbs which would be pushed out of sentry's ring
+// before the next flush are never written at all.  Breadcrumbs still in the queue
+// when crashing are passed to sentry by the crash callback, before the report is written.
+class FSentryBreadcrumbQueue : public FRunnable
+{
+public:
+	FSentryBreadcrumbQueue(int32 IntervalMs);
+	virtual ~FSentryBreadcrumbQueue();
+
+	// Queue a breadcrumb, taking ownership of it, if there is a queue.  Returns false if there is
+	// none.  Can be called from any thread, also while the queue is destroyed, which waits for
+	// the callers in flight.
+	static bool AddActive(sentry_value_t Breadcrumb);
+
+	// Pass queued breadcrumbs to sentry now
+	void Flush();
+
+	// Pass queued breadcrumbs to sentry from the crash callback.  The backends build the report
+	// from the scope, crashpad from the scope written to disk, so the breadcrumbs go there and
+	// not into the event passed to the callback.  Gives up if the queue is locked.
+	void FlushOnCrash();
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	// sentry-native keeps this many breadcrumbs, anything older is dropped
+	static constexpr int32 MaxBreadcrumbs = 100;
+
+	void Add(sentry_value_t Breadcrumb);
+
+	// the queue breadcrumbs go to, and the number of threads which may be adding to it
+	static std::atomic<FSentryBreadcrumbQueue*> Active;
+	static std::atomic<int32> Writers;
+
+	uint32 IntervalMs = 100;
+
+	FCriticalSection Lock;
+	TArray<sentry_value_t> Queued;
+
+	// statistics, logged at shutdown
+	uint64 NumAdded = 0;
+	uint64 NumWritten = 0;
+	uint64 NumFlushes = 0;
+
+	std::atomic<bool> bStopping{ false };
+	FEvent* WakeEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+};
+
+#endif
@@ -1,7 +1,26 @@
 #include "SentryClientModule.h"
 #include "SentryTransport.h"
+#include "SentryCrashLoop.h"
+#include "SentryHangWatchdog.h"
+#include "SentryEnsureReporter.h"
+#include "SentryJournal.h"
+#include "SentryMemoryWatch.h"
+#include "SentryMemoryTrend.h"
+#include "SentryDatabasePruner.h"
+#include "SentryBreadcrumbQueue.h"
+#include "SentryTracing.h"
+#include "SentryLevelLoadTracker.h"
+#include "SentryFrameStats.h"
+#include "SentryServerHealth.h"
+#include "SentryGCTracker.h"
+#include "SentryAsyncLoadTracker.h"
+#include "SentryTraceSnapshot.h"
+#include "SentrySpanRecorder.h"
+#include "SentryStatBridge.h"
+#include "SentrySessionAggregator.h"
 #include "BlueprintLib.h"
 
+#include "CoreGlobals.h"
 #include "Misc/Paths.h"
 #include "Misc/CommandLine.h"
 #include "HAL/PlatformMisc.h"
@@ -10,6 +29,12 @@
 #include "Modules/ModuleManager.h"
 #include "Kismet/KismetSystemLibrary.h"  // for user name
 #include "HAL/PlatformProcess.h"	// for hostname
+#include "HAL/PlatformTime.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/CoreDelegates.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "UObject/UObjectGlobals.h"
 
 
 #include <stdio.h>
@@ -31,6 +56,13 @@ FSentryErrorOutputDevice FSentryClientModule::ErrorDevice = FSentryErrorOutputDe
 
 void FSentryOutputDevice::Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const class FName& Category)
 {
+#if SENTRY_HAVE_PLATFORM
+	// failed ensures become events of their own, regardless of breadcrumb verbosity
+	if (Verbosity <= ELogVerbosity::Error && module->IsCapturingEnsures() && FSentryEnsureReporter::IsEnsureMessage(V))
+	{
+		module->CaptureEnsure(V);
+	}
+#endif
 
 	// do nothing if this is a too-high verbosity message
 	if (Verbosity > module->GetVerbosity())
@@ -76,7 +108,13 @@ void FSentryOutputDevice::StaticSerialize(const TCHAR* V, ELogVerbosity::Type Ve
 		sentry_value_set_by_key(crumb, "level", sentry_value_new_string(clevel));
 	}
 
-	sentry_add_breadcrumb(crumb);
+	if (!FSentryBreadcrumbQueue::AddActive(crumb))
+	{
+		sentry_add_breadcrumb(crumb);
+	}
+
+	// keep a copy that survives the process being killed
+	FSentryJournal::AddActiveBreadcrumb(clevel, Category, V);
 #endif
 }
 
@@ -113,6 +151,17 @@ static sentry_value_t _SentryCrash(const sentry_ucontext_t* uctx, sentry_value_t
 	return module->SentryCrash(uctx, event);
 }
 
+static sentry_value_t _SentryBeforeSend(sentry_value_t event, void* hint, void* closure)
+{
+	// error events mark the open sessions as errored
+	const char* level = sentry_value_as_string(sentry_value_get_by_key(event, "level"));
+	if (FCStringAnsi::Strcmp(level, "error") == 0 || FCStringAnsi::Strcmp(level, "fatal") == 0)
+	{
+		FSentrySessionAggregator::OnErrorEvent();
+	}
+	return event;
+}
+
 #endif
 
 
@@ -166,6 +215,100 @@ FString USentryClientConfig::GetConfig(const TCHAR *name, const TCHAR *defaultva
 	return defaultval ? defaultval : TEXT("");
 }
 
+bool USentryClientConfig::GetConfigBool(const TCHAR* name, bool defaultval)
+{
+	FString result;
+	if (GetEnvOrCmdLine(name, result))
+	{
+		return FCString::ToBool(*result);
+	}
+	return defaultval;
+}
+
+int32 USentryClientConfig::GetConfigInt(const TCHAR* name, int32 defaultval)
+{
+	FString result;
+	if (GetEnvOrCmdLine(name, result))
+	{
+		return FCString::Atoi(*result);
+	}
+	return defaultval;
+}
+
+float USentryClientConfig::GetConfigFloat(const TCHAR* name, float defaultval)
+{
+	FString result;
+	if (GetEnvOrCmdLine(name, result))
+	{
+		return FCString::Atof(*result);
+	}
+	return defaultval;
+}
+
+bool USentryClientConfig::GetIniValue(const TCHAR* key, FString& out)
+{
+	// load the Sentry.ini hierarchy the same way the config object would
+	static FString IniFilename;
+	if (IniFilename.IsEmpty())
+	{
+		FConfigCacheIni::LoadGlobalIniFile(IniFilename, TEXT("Sentry"));
+	}
+	return GConfig && GConfig->GetString(TEXT("/Script/SentryClient.SentryClientConfig"), key, out, IniFilename);
+}
+
+FString USentryClientConfig::GetSetting(const TCHAR* key, FString USentryClientConfig::* member)
+{
+	if (UObjectInitialized())
+	{
+		return Get()->*member;
+	}
+	FString value;
+	GetIniValue(key, value);
+	return value;
+}
+
+bool USentryClientConfig::GetSetting(const TCHAR* key, bool USentryClientConfig::* member, bool defaultval)
+{
+	if (UObjectInitialized())
+	{
+		return Get()->*member;
+	}
+	FString value;
+	if (GetIniValue(key, value))
+	{
+		return FCString::ToBool(*value);
+	}
+	return defaultval;
+}
+
+int32 USentryClientConfig::GetSetting(const TCHAR* key, int32 USentryClientConfig::* member, int32 defaultval)
+{
+	if (UObjectInitialized())
+	{
+		return Get()->*member;
+	}
+	FString value;
+	if (GetIniValue(key, value))
+	{
+		return FCString::Atoi(*value);
+	}
+	return defaultval;
+}
+
+float USentryClientConfig::GetSetting(const TCHAR* key, float USentryClientConfig::* member, float defaultval)
+{
+	if (UObjectInitialized())
+	{
+		return Get()->*member;
+	}
+	FString value;
+	if (GetIniValue(key, value))
+	{
+		return FCString::Atof(*value);
+	}
+	return defaultval;
+}
+
 bool USentryClientConfig::IsEnabled()
 {
 	// command line or env can override
@@ -184,12 +327,12 @@ bool USentryClientConfig::IsEnabled()
 	}
 
 	// Config can disable it
-	bool enabled = Get()->Enabled;
+	bool enabled = GetSetting(TEXT("Enabled"), &USentryClientConfig::Enabled, true);
 
 	// and we can have logic to disable it too, e.g. for local builds.
 	if (enabled)
 	{
-		enabled = !Get()->ShouldDisable();
+		enabled = !ShouldDisable();
 	}
 	return enabled;
 }
@@ -202,22 +345,22 @@ bool USentryClientConfig::ShouldDisable()
 
 FString USentryClientConfig::GetDSN()
 {
-	return GetConfig(TEXT("DSN"), *Get()->DSN);
+	return GetConfig(TEXT("DSN"), *GetSetting(TEXT("DSN"), &USentryClientConfig::DSN));
 }
 
 FString USentryClientConfig::GetEnvironment()
 {
-	return GetConfig(TEXT("ENVIRONMENT"), *Get()->Environment);
+	return GetConfig(TEXT("ENVIRONMENT"), *GetSetting(TEXT("Environment"), &USentryClientConfig::Environment));
 }
 
 FString USentryClientConfig::GetRelease()
 {
-	return GetConfig(TEXT("RELEASE"), *Get()->Release);
+	return GetConfig(TEXT("RELEASE"), *GetSetting(TEXT("Release"), &USentryClientConfig::Release));
 }
 
 FString USentryClientConfig::GetDatabasePath()
 {
-	return GetConfig(TEXT("DATABASE_PATH"), nullptr);
+	return GetConfig(TEXT("DATABASE_PATH"), *GetSetting(TEXT("DatabasePath"), &USentryClientConfig::DatabasePath));
 }
 
 bool USentryClientConfig::IsConsentRequired()
@@ -225,7 +368,7 @@ bool USentryClientConfig::IsConsentRequired()
 	FString val = GetEnvOrCmdLine(TEXT("CONSENT_REQUIRED"));
 	if (val.IsEmpty())
 	{
-		return Get()->ConsentRequired;
+		return GetSetting(TEXT("ConsentRequired"), &USentryClientConfig::ConsentRequired, false);
 	}
 	if (val.Equals(TEXT("yes"), ESearchCase::IgnoreCase) == 0)
 		return true;
@@ -268,6 +411,9 @@ void FSentryClientModule::StartupModule()
 {
 #if SENTRY_HAVE_PLATFORM
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	// We are loaded in the PostConfigInit phase, so that crashes during engine startup are
+	// caught as well.  The UObject system isn't up yet, so only the crash backend is set up here,
+	// the rest happens in CompleteInit() after engine init.
 	
 	// plugin settings are generally accessed, in increased priority, from:
 	// - Builtin
@@ -293,22 +439,21 @@ void FSentryClientModule::StartupModule()
 	FString env = USentryClientConfig::GetEnvironment();
 	FString rel = USentryClientConfig::GetRelease();
 
-	bool init = SentryInit(*dsn,
+	bool init = InitBackend(*dsn,
 		env.IsEmpty() ? nullptr : *env,
 		rel.IsEmpty() ? nullptr : *rel,
 		USentryClientConfig::IsConsentRequired()
 	);
 	if (init)
 	{
-		// Set some default information (username, hostname)
-		USentryBlueprintLibrary::SetUser(FString(), UKismetSystemLibrary::GetPlatformUserName(), FString());
-		USentryBlueprintLibrary::SetTag(TEXT("hostname"), FPlatformProcess::ComputerName());
-
-		// additional tags passed from command line
-		auto tagmap = USentryClientConfig::GetTags();
-		for(auto &elem : tagmap)
+		// the rest needs the engine, run it when it is up.
+		if (GIsRunning)
+		{
+			CompleteInit();
+		}
+		else
 		{
-			USentryBlueprintLibrary::SetTag(elem.Key, elem.Value);
+			PostEngineInitHandle = FCoreDelegates::OnPostEngineInit.AddRaw(this, &FSentryClientModule::OnPostEngineInit);
 		}
 	}
 #else
@@ -324,20 +469,32 @@ void FSentryClientModule::ShutdownModule()
 }
 
 bool FSentryClientModule::SentryInit(const TCHAR* DSN, const TCHAR* Environment, const TCHAR* Release, bool IsConsentRequired)
+{
+	if (InitBackend(DSN, Environment, Release, IsConsentRequired))
+	{
+		CompleteInit();
+	}
+	return initialized;
+}
+
+bool FSentryClientModule::InitBackend(const TCHAR* DSN, const TCHAR* Environment, const TCHAR* Release, bool IsConsentRequired)
 {
 #if SENTRY_HAVE_PLATFORM
 	if (initialized)
 		SentryClose();
 	check(DSN != nullptr);
+	InitStartTime = FPlatformTime::Seconds();
 
 
 	sentry_options_t* options = sentry_options_new();
 
-	// Database location.  Pull in a config env var
+	// Database location.  Pull in a config env var, can be a list of fallbacks
 	FString ConfigDBPath = USentryClientConfig::GetDatabasePath();
 	if (!ConfigDBPath.IsEmpty())
 	{
-		dbPath = ConfigDBPath;
+		const int32 MaxSizeMB = USentryClientConfig::GetConfigInt(TEXT("DATABASE_MAX_SIZE_MB"),
+			USentryClientConfig::GetSetting(TEXT("DatabaseMaxSizeMB"), &USentryClientConfig::DatabaseMaxSizeMB, 0));
+		dbPath = FSentryDatabasePruner::SelectDatabasePath(ConfigDBPath, MaxSizeMB);
 	}
 	// Default database location in the game's Saved folder
 	if (dbPath.IsEmpty())
@@ -352,10 +509,22 @@ bool FSentryClientModule::SentryInit(const TCHAR* DSN, const TCHAR* Environment,
 	sentry_options_set_database_path(options, TCHAR_TO_UTF8(*dbPath));
 #endif
 
+	// Look at the crash history before deciding what to send
+	CrashLoop = MakeUnique<FSentryCrashLoop>(dbPath);
+
+	// Detect runs that ended without a crash or an orderly shutdown
+	if (USentryClientConfig::GetConfigBool(TEXT("ABNORMAL_EXIT_DETECTION"),
+		USentryClientConfig::GetSetting(TEXT("AbnormalExitDetection"), &USentryClientConfig::AbnormalExitDetection, false)))
+	{
+		Journal = MakeUnique<FSentryJournal>(dbPath);
+	}
+
 	// Location of the crashpad_backend.exe on windows
 	// or crashpad_backend on linux.
 	// This must match the SentryClient.build.cs paths
-#if PLATFORM_WINDOWS
+#if !SENTRY_BACKEND_CRASHPAD
+	// breakpad and inproc handle crashes in process
+#elif PLATFORM_WINDOWS
 	if (CrashPadLocation.IsEmpty())
 	{
 		auto Plugin = IPluginManager::Get().FindPlugin(SENTRY_PLUGIN_NAME);
@@ -393,34 +562,65 @@ if (CrashPadLocation.IsEmpty())
 	sentry_options_set_logger(options, _SentryLog, (void*)this);
 	sentry_options_set_debug(options, 1);
 
-	// We want sentry to send the log with any crash
-	// TODO: make it possible to only add this with crashes, not other events?
-	FString logfile = FPlatformOutputDevices::GetAbsoluteLogFilename();
-	logfile = FPaths::ConvertRelativePathToFull(logfile);
+	// When crash looping, keep the reports small
+	if (!CrashLoop->IsCrashLooping())
+	{
+		// We want sentry to send the log with any crash
+		// TODO: make it possible to only add this with crashes, not other events?
+		FString logfile = FPlatformOutputDevices::GetAbsoluteLogFilename();
+		logfile = FPaths::ConvertRelativePathToFull(logfile);
 #if PLATFORM_WINDOWS
-	sentry_options_add_attachmentw(options, *logfile);
+		sentry_options_add_attachmentw(options, *logfile);
 #else
-	sentry_options_add_attachment(options, TCHAR_TO_UTF8(*logfile));
+		sentry_options_add_attachment(options, TCHAR_TO_UTF8(*logfile));
 #endif
 
 #if !UE_SERVER
-	FString feedbackScreenshot = FPaths::ScreenShotDir() / TEXT("feedback.png");
+		FString feedbackScreenshot = FPaths::ScreenShotDir() / TEXT("feedback.png");
 #if PLATFORM_WINDOWS
-	sentry_options_add_attachmentw(options, *feedbackScreenshot);
+		sentry_options_add_attachmentw(options, *feedbackScreenshot);
 #else
-	sentry_options_add_attachment(options, TCHAR_TO_UTF8(*feedbackScreenshot));
+		sentry_options_add_attachment(options, TCHAR_TO_UTF8(*feedbackScreenshot));
 #endif
 #endif
+	}
 	
 	// Consent handling
 	sentry_options_set_require_user_consent(options, IsConsentRequired);
+	ReleaseName = Release ? Release : TEXT("");
+	EnvironmentName = Environment ? Environment : TEXT("");
+	bConsentRequired = IsConsentRequired;
 
 	// create a sentry transport
-	sentry_options_set_transport(options, FSentryTransport::New());
+	sentry_options_set_transport(options, FSentryTransport::New(Transport));
 
 	// Set an on crash callback
 	sentry_options_set_on_crash(options, _SentryCrash, (void*)this);
 
+	// Release health.  A dedicated server hosts many players, so it counts their sessions
+	// itself rather than having a single session for the process.
+	bSessionAggregates = IsRunningDedicatedServer() && USentryClientConfig::GetConfigBool(TEXT("SERVER_SESSION_AGGREGATES"),
+		USentryClientConfig::GetSetting(TEXT("ServerSessionAggregates"), &USentryClientConfig::ServerSessionAggregates, false));
+	const bool bSessionTracking = USentryClientConfig::GetConfigBool(TEXT("SESSION_TRACKING"),
+		USentryClientConfig::GetSetting(TEXT("SessionTracking"), &USentryClientConfig::SessionTracking, true));
+	sentry_options_set_auto_session_tracking(options, bSessionTracking && !bSessionAggregates);
+	if (bSessionAggregates)
+	{
+		sentry_options_set_before_send(options, _SentryBeforeSend, (void*)this);
+	}
+
+	// Performance monitoring.  Transactions are sampled when they are started
+	// (FSentryTransaction::Start), so that unsampled ones cost nothing.
+	const float TracesSampleRate = USentryClientConfig::GetConfigFloat(TEXT("TRACES_SAMPLE_RATE"),
+		USentryClientConfig::GetSetting(TEXT("TracesSampleRate"), &USentryClientConfig::TracesSampleRate, 0.0f));
+	if (TracesSampleRate > 0.0f)
+	{
+		sentry_options_set_traces_sample_rate(options, 1.0);
+	}
+	FSentryTransaction::SetSampleRate(TracesSampleRate);
+	sentry_options_set_max_spans(options, (size_t)FMath::Max(1, USentryClientConfig::GetConfigInt(TEXT("MAX_SPANS"),
+		USentryClientConfig::GetSetting(TEXT("MaxSpans"), &USentryClientConfig::MaxSpans, 1000))));
+
 	// Todo: set up a thing to add log breadcrumbs
 
 	UE_LOG(LogSentryClient, Log, TEXT("Initializing with DSN '%s', env='%s', rel='%s'"), 
@@ -429,8 +629,26 @@ if (CrashPadLocation.IsEmpty())
 	if (!fail)
 	{
 		initialized = true;
+		CrashLoop->OnInitialized();
+		if (Journal)
+		{
+			Journal->ReportPreviousRuns();
+			if (!Journal->IsValid())
+			{
+				Journal.Reset();
+			}
+		}
+
+		// Batch the log breadcrumbs, each one is written to disk with crashpad
+		const int32 FlushInterval = USentryClientConfig::GetConfigInt(TEXT("BREADCRUMB_FLUSH_INTERVAL"),
+			USentryClientConfig::GetSetting(TEXT("BreadcrumbFlushInterval"), &USentryClientConfig::BreadcrumbFlushInterval, 0));
+		if (FlushInterval > 0)
+		{
+			BreadcrumbQueue = MakeUnique<FSentryBreadcrumbQueue>(FlushInterval);
+		}
 
-		// Hook the log stream handler into GLog
+		// Hook the log stream handler into GLog.  This is cheap, and doing it early
+		// means that the breadcrumbs cover engine startup.
 		GLog->AddOutputDevice(LogDevice.Get());
 		GLog->SerializeBacklog(LogDevice.Get());
 
@@ -441,9 +659,6 @@ if (CrashPadLocation.IsEmpty())
 			GError = &ErrorDevice;
 		}
 
-		// Set default context stuff
-		SetupContext();
-
 #if HAVE_CRASH_HANDLING_THING
 		// instruct UE not to try to do crash handling itself
 		FPlatformMisc::SetCrashHandlingType(ECrashHandlingType::Disabled);
@@ -452,16 +667,84 @@ if (CrashPadLocation.IsEmpty())
 	else
 	{
 		UE_LOG(LogSentryClient, Warning, TEXT("Failed to initialize, code %d"), fail);
+		if (Journal)
+		{
+			Journal->MarkClean();
+			Journal.Reset();
+		}
 	}
+	BackendInitTime = FPlatformTime::Seconds() - InitStartTime;
 	return initialized;
 #else // SENTRY_HAVE_PLATFORM
 	return false;
 #endif
 }
 
+void FSentryClientModule::OnPostEngineInit()
+{
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+	PostEngineInitHandle.Reset();
+	if (initialized)
+	{
+		CompleteInit();
+	}
+}
+
+void FSentryClientModule::CompleteInit()
+{
+#if SENTRY_HAVE_PLATFORM
+	const double Start = FPlatformTime::Seconds();
+
+	// Envelopes captured so far have been queued by the transport
+	Transport->Warmup();
+	const double TransportTime = FPlatformTime::Seconds() - Start;
+
+	StartFeatures();
+	const double FeaturesTime = FPlatformTime::Seconds() - Start - TransportTime;
+
+	// The default user and tags are set here, before any game code runs, so that the
+	// game's own SetUser and SetTag calls replace them rather than the other way round.
+	USentryBlueprintLibrary::SetUser(FString(), UKismetSystemLibrary::GetPlatformUserName(), FString());
+	USentryBlueprintLibrary::SetTag(TEXT("hostname"), FPlatformProcess::ComputerName());
+
+	// additional tags passed from command line
+	auto tagmap = USentryClientConfig::GetTags();
+	for(auto &elem : tagmap)
+	{
+		USentryBlueprintLibrary::SetTag(elem.Key, elem.Value);
+	}
+
+	// The contexts don't need the game thread and involve some string processing,
+	// so do them in the background.  The game doesn't set these contexts.
+	ContextTask = Async(EAsyncExecution::ThreadPool, [this, Start, TransportTime, FeaturesTime]()
+	{
+		const double ContextStart = FPlatformTime::Seconds();
+
+		// Set default context stuff
+		SetupContext();
+
+		const double End = FPlatformTime::Seconds();
+		UE_LOG(LogSentryClient, Log, TEXT("Startup timing: backend %.1f ms, transport %.1f ms, features %.1f ms, context %.1f ms (%.1f ms after backend init)"),
+			BackendInitTime * 1000.0, TransportTime * 1000.0, FeaturesTime * 1000.0,
+			(End - ContextStart) * 1000.0, (End - Start) * 1000.0);
+	});
+#endif
+}
+
 void FSentryClientModule::SentryClose()
 {
 #if SENTRY_HAVE_PLATFORM
+	if (PostEngineInitHandle.IsValid())
+	{
+		FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+		PostEngineInitHandle.Reset();
+	}
+	if (ContextTask.IsValid())
+	{
+		ContextTask.Wait();
+		ContextTask = TFuture<void>();
+	}
+
 	if (initialized)
 	{
 		if (GLog)
@@ -469,6 +752,9 @@ void FSentryClientModule::SentryClose()
 			GLog->RemoveOutputDevice(LogDevice.Get());
 		}
 
+		StopFeatures();
+		BreadcrumbQueue.Reset();
+
 		int fail = sentry_close();
 		if (!fail)
 		{
@@ -479,7 +765,216 @@ void FSentryClientModule::SentryClose()
 			UE_LOG(LogSentryClient, Error, TEXT("Failed to close, error %d"), fail);
 		}
 	}
+	if (Journal)
+	{
+		Journal->MarkClean();
+		Journal.Reset();
+	}
 	initialized = false;
+	Transport.Reset();
+	CrashLoop.Reset();
+#endif
+}
+
+void FSentryClientModule::StartFeatures()
+{
+#if SENTRY_HAVE_PLATFORM
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FSentryClientModule::OnEndFrame);
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FSentryClientModule::OnPostLoadMap);
+
+	// keeps the database within its limits, starts pruning right away
+	if (USentryClientConfig::GetConfigInt(TEXT("DATABASE_MAX_SIZE_MB"), USentryClientConfig::Get()->DatabaseMaxSizeMB) > 0 ||
+		USentryClientConfig::GetConfigFloat(TEXT("DATABASE_MAX_AGE_DAYS"), USentryClientConfig::Get()->DatabaseMaxAgeDays) > 0.0f)
+	{
+		DatabasePruner = MakeUnique<FSentryDatabasePruner>(dbPath);
+	}
+
+	if (USentryClientConfig::GetConfigBool(TEXT("HANG_DETECTION"), USentryClientConfig::Get()->HangDetection))
+	{
+		HangWatchdog = MakeUnique<FSentryHangWatchdog>();
+		HangWatchdog->Start();
+	}
+
+	if (USentryClientConfig::GetConfigBool(TEXT("CAPTURE_ENSURES"), USentryClientConfig::Get()->CaptureEnsures))
+	{
+		EnsureReporter = MakeUnique<FSentryEnsureReporter>();
+	}
+
+	if (USentryClientConfig::GetConfigBool(TEXT("LOW_MEMORY_REPORTING"), USentryClientConfig::Get()->LowMemoryReporting))
+	{
+		MemoryWatch = MakeUnique<FSentryMemoryWatch>();
+	}
+
+	if (USentryClientConfig::GetConfigBool(TEXT("MEMORY_TREND"), USentryClientConfig::Get()->MemoryTrend))
+	{
+		MemoryTrend = MakeUnique<FSentryMemoryTrend>();
+		MemoryTrend->Start();
+	}
+
+	// before anything which starts transactions.  Without it, transactions go through sentry-native
+	const bool bTailSampling = USentryClientConfig::GetConfigBool(TEXT("TAIL_SAMPLING"), USentryClientConfig::Get()->TailSampling);
+	if (FSentryTransaction::IsTracingEnabled() &&
+		(bTailSampling || USentryClientConfig::GetConfigBool(TEXT("RECORD_TRANSACTIONS"), USentryClientConfig::Get()->RecordTransactions)))
+	{
+		SpanRecorder = MakeUnique<FSentrySpanRecorder>(Transport, ReleaseName, EnvironmentName, bConsentRequired, bTailSampling);
+	}
+
+	if (FSentryTransaction::IsTracingEnabled() &&
+		USentryClientConfig::GetConfigBool(TEXT("TRACE_LEVEL_LOADS"), USentryClientConfig::Get()->TraceLevelLoads))
+	{
+		LevelLoadTracker = MakeUnique<FSentryLevelLoadTracker>();
+	}
+
+	if (USentryClientConfig::GetConfigBool(TEXT("FRAME_STATS"), USentryClientConfig::Get()->FrameStats))
+	{
+		FrameStats = MakeUnique<FSentryFrameStats>();
+	}
+
+	if (IsRunningDedicatedServer() && USentryClientConfig::GetConfigBool(TEXT("SERVER_HEALTH"), USentryClientConfig::Get()->ServerHealth))
+	{
+		ServerHealth = MakeUnique<FSentryServerHealth>();
+	}
+
+	if (USentryClientConfig::GetConfigBool(TEXT("GC_TRACKING"), USentryClientConfig::Get()->GCTracking))
+	{
+		GCTracker = MakeUnique<FSentryGCTracker>();
+	}
+
+	if (USentryClientConfig::GetConfigBool(TEXT("ASYNC_LOAD_TRACKING"), USentryClientConfig::Get()->AsyncLoadTracking))
+	{
+		AsyncLoadTracker = MakeUnique<FSentryAsyncLoadTracker>();
+	}
+
+	if (USentryClientConfig::GetConfigBool(TEXT("TRACE_SNAPSHOTS"), USentryClientConfig::Get()->TraceSnapshots))
+	{
+		TraceSnapshot = MakeUnique<FSentryTraceSnapshot>(Transport);
+	}
+
+	const FString StatSpans = USentryClientConfig::GetConfig(TEXT("STAT_SPANS"), *USentryClientConfig::Get()->StatSpans);
+	if (FSentryTransaction::IsTracingEnabled() && !StatSpans.IsEmpty())
+	{
+#if STATS
+		StatBridge = MakeUnique<FSentryStatBridge>(StatSpans);
+#else
+		UE_LOG(LogSentryClient, Warning, TEXT("StatSpans is set, but stats are not compiled into this build"));
+#endif
+	}
+
+	if (bSessionAggregates)
+	{
+		SessionAggregator = MakeUnique<FSentrySessionAggregator>(Transport, dbPath, ReleaseName, EnvironmentName,
+			bConsentRequired, CrashLoop->CrashedLastRun());
+	}
+#endif
+}
+
+void FSentryClientModule::StopFeatures()
+{
+#if SENTRY_HAVE_PLATFORM
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	EndFrameHandle.Reset();
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	PostLoadMapHandle.Reset();
+
+	if (HangWatchdog)
+	{
+		HangWatchdog->Shutdown();
+		HangWatchdog.Reset();
+	}
+	EnsureReporter.Reset();
+	MemoryWatch.Reset();
+	if (MemoryTrend)
+	{
+		MemoryTrend->Shutdown();
+		MemoryTrend.Reset();
+	}
+	DatabasePruner.Reset();
+	LevelLoadTracker.Reset();
+	FrameStats.Reset();
+	ServerHealth.Reset();
+	GCTracker.Reset();
+	AsyncLoadTracker.Reset();
+	TraceSnapshot.Reset();
+#if STATS
+	StatBridge.Reset();
+#endif
+	SessionAggregator.Reset();
+	SpanRecorder.Reset();
+#endif
+}
+
+void FSentryClientModule::CaptureEnsure(const TCHAR* Msg)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (EnsureReporter)
+	{
+		EnsureReporter->OnEnsure(Msg);
+	}
+#endif
+}
+
+void FSentryClientModule::OnEndFrame()
+{
+#if SENTRY_HAVE_PLATFORM
+	CrashLoop->Tick();
+	if (Journal)
+	{
+		Journal->Tick();
+	}
+	if (HangWatchdog)
+	{
+		HangWatchdog->Heartbeat();
+	}
+	if (MemoryWatch)
+	{
+		MemoryWatch->Tick();
+	}
+	if (DatabasePruner)
+	{
+		DatabasePruner->Tick();
+	}
+	if (FrameStats)
+	{
+		FrameStats->Tick();
+	}
+	if (ServerHealth)
+	{
+		ServerHealth->Tick();
+	}
+	if (AsyncLoadTracker)
+	{
+		AsyncLoadTracker->Tick();
+	}
+	if (TraceSnapshot)
+	{
+		TraceSnapshot->Tick();
+	}
+	if (SpanRecorder)
+	{
+		SpanRecorder->Tick();
+	}
+	if (SessionAggregator)
+	{
+		SessionAggregator->Tick();
+	}
+#if STATS
+	if (StatBridge)
+	{
+		StatBridge->Tick();
+	}
+#endif
+#endif
+}
+
+void FSentryClientModule::OnPostLoadMap(UWorld* World)
+{
+#if SENTRY_HAVE_PLATFORM
+	// tag events with the map they happened on
+	if (World)
+	{
+		sentry_set_tag("map", TCHAR_TO_UTF8(*World->GetMapName()));
+		FSentryTransaction::SetSamplingMap(World->GetMapName());
+	}
 #endif
 }
 
@@ -577,6 +1072,25 @@ sentry_value_t FSentryClientModule::SentryCrash(const sentry_ucontext_t* uctx, s
 		GLog->PanicFlushThreadedLogs();
 # endif
 	}
+
+#if SENTRY_HAVE_PLATFORM
+	if (Journal)
+	{
+		Journal->MarkCrashed();
+	}
+	if (BreadcrumbQueue)
+	{
+		BreadcrumbQueue->FlushOnCrash();
+	}
+
+	// in a crash loop, only a sample of the crashes is uploaded.  Discarding
+	// the event here also means the backend doesn't write a minidump.
+	if (CrashLoop && !CrashLoop->ShouldReportCrash())
+	{
+		sentry_value_decref(event);
+		return sentry_value_new_null();
+	}
+#endif
 	return event;
 }
 
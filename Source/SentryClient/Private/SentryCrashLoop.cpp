@@ -0,0 +1,151 @@
+#include "SentryCrashLoop.h"
+#include "SentryClientModule.h"
+
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/Guid.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentryCrashLoop::FSentryCrashLoop(const FString& DatabasePath)
+{
+	// we are created before the config object is available
+	Threshold = USentryClientConfig::GetConfigInt(TEXT("CRASH_LOOP_THRESHOLD"),
+		USentryClientConfig::GetSetting(TEXT("CrashLoopThreshold"), &USentryClientConfig::CrashLoopThreshold, Threshold));
+	Window = USentryClientConfig::GetConfigFloat(TEXT("CRASH_LOOP_WINDOW"),
+		USentryClientConfig::GetSetting(TEXT("CrashLoopWindow"), &USentryClientConfig::CrashLoopWindow, Window));
+	RecoveryTime = USentryClientConfig::GetConfigFloat(TEXT("CRASH_LOOP_RECOVERY_TIME"),
+		USentryClientConfig::GetSetting(TEXT("CrashLoopRecoveryTime"), &USentryClientConfig::CrashLoopRecoveryTime, RecoveryTime));
+	MinidumpSampleRate = USentryClientConfig::GetConfigFloat(TEXT("CRASH_LOOP_SAMPLE_RATE"),
+		USentryClientConfig::GetSetting(TEXT("CrashLoopSampleRate"), &USentryClientConfig::CrashLoopSampleRate, MinidumpSampleRate));
+	CrashSample = FRandomStream(GetTypeHash(FGuid::NewGuid())).FRand();
+
+	HistoryFile = FPaths::Combine(DatabasePath, TEXT("crash-history.txt"));
+	StartTime = FPlatformTime::Seconds();
+	if (Threshold <= 0)
+	{
+		return;
+	}
+
+	Load();
+	Prune(FDateTime::UtcNow().ToUnixTimestamp());
+	Evaluate();
+	if (bCrashLooping)
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("Crash loop detected (%d crashes in %.0f s), reporting in lightweight mode"), CrashTimes.Num(), Window);
+	}
+}
+
+void FSentryCrashLoop::OnInitialized()
+{
+	if (sentry_get_crashed_last_run() == 1)
+	{
+		bCrashedLastRun = true;
+		sentry_clear_crashed_last_run();
+	}
+
+	if (bCrashedLastRun && Threshold > 0)
+	{
+		// We don't know exactly when it happened, but it was recently
+		const int64 Now = FDateTime::UtcNow().ToUnixTimestamp();
+		CrashTimes.Add(Now);
+		Prune(Now);
+		Save();
+
+		// Attachments are already configured, but the rest can still be applied
+		if (!bCrashLooping)
+		{
+			Evaluate();
+			if (bCrashLooping)
+			{
+				UE_LOG(LogSentryClient, Warning, TEXT("Crash loop detected (%d crashes in %.0f s), reporting in lightweight mode"), CrashTimes.Num(), Window);
+			}
+		}
+	}
+
+	if (bCrashLooping)
+	{
+		sentry_set_tag("crash_loop", "true");
+	}
+}
+
+void FSentryCrashLoop::Tick()
+{
+	if (bRecovered || CrashTimes.Num() == 0)
+	{
+		return;
+	}
+	if (FPlatformTime::Seconds() - StartTime < RecoveryTime)
+	{
+		return;
+	}
+
+	// we have been up long enough, forget about previous crashes
+	bRecovered = true;
+	CrashTimes.Empty();
+	IFileManager::Get().Delete(*HistoryFile, false, false, true);
+	if (bCrashLooping)
+	{
+		bCrashLooping = false;
+		sentry_remove_tag("crash_loop");
+		UE_LOG(LogSentryClient, Log, TEXT("Stable for %.0f s, leaving crash loop mode"), RecoveryTime);
+	}
+}
+
+bool FSentryCrashLoop::ShouldReportCrash() const
+{
+	if (!bCrashLooping)
+	{
+		return true;
+	}
+	return CrashSample < MinidumpSampleRate;
+}
+
+void FSentryCrashLoop::Load()
+{
+	FString Contents;
+	if (!FFileHelper::LoadFileToString(Contents, *HistoryFile))
+	{
+		return;
+	}
+	TArray<FString> Lines;
+	Contents.ParseIntoArrayLines(Lines);
+	for (auto& Line : Lines)
+	{
+		int64 Time = FCString::Atoi64(*Line);
+		if (Time > 0)
+		{
+			CrashTimes.Add(Time);
+		}
+	}
+}
+
+void FSentryCrashLoop::Save() const
+{
+	FString Contents;
+	for (int64 Time : CrashTimes)
+	{
+		Contents += FString::Printf(TEXT("%lld\n"), Time);
+	}
+	FFileHelper::SaveStringToFile(Contents, *HistoryFile);
+}
+
+void FSentryCrashLoop::Prune(int64 Now)
+{
+	CrashTimes.RemoveAll([this, Now](int64 Time)
+	{
+		return Time < Now - (int64)Window;
+	});
+}
+
+void FSentryCrashLoop::Evaluate()
+{
+	bCrashLooping = Threshold > 0 && CrashTimes.Num() >= Threshold;
+}
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+// Detects when the game is crashing repeatedly, e.g. a server crashing on boot and being
+// restarted by an orchestrator.  Crashes of previous runs (sentry_get_crashed_last_run)
+// are recorded in a file in the database folder.  When too many happen within a time window,
+// we switch to a lightweight mode: no attachments, only a sample of the minidumps is
+// uploaded and events are tagged with crash_loop.  Once the game has been running for
+// a while, the history is cleared again.  Disabled unless a threshold is set.  The history
+// belongs to the database folder, instances sharing a folder count each other's crashes.
+class FSentryCrashLoop
+{
+public:
+	FSentryCrashLoop(const FString& DatabasePath);
+
+	// Are we in a crash loop?  Decided before sentry_init, from the recorded history.
+	bool IsCrashLooping() const { return bCrashLooping; }
+
+	// Call after sentry_init, records a crash of the previous run.
+	void OnInitialized();
+
+	// Did the previous run crash?  Known after OnInitialized.
+	bool CrashedLastRun() const { return bCrashedLastRun; }
+
+	// Call regularly.  Resets the history after a stable uptime.
+	void Tick();
+
+	// Should the report of the current crash be sent?
+	bool ShouldReportCrash() const;
+
+private:
+	void Load();
+	void Save() const;
+	void Prune(int64 Now);
+	void Evaluate();
+
+	FString HistoryFile;
+	TArray<int64> CrashTimes;	// unix time of recent crashes
+
+	int32 Threshold = 0;
+	double Window = 600.0;
+	double RecoveryTime = 600.0;
+	float MinidumpSampleRate = 0.1f;
+	// drawn once at startup, so that the crash handler doesn't touch the game's rand() stream
+	float CrashSample = 0.0f;
+
+	bool bCrashLooping = false;
+	bool bCrashedLastRun = false;
+	bool bRecovered = false;
+	double StartTime = 0.0;
+};
+
+#endif
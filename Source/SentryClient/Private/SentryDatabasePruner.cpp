@@ -0,0 +1,222 @@
+#include "SentryDatabasePruner.h"
+#include "SentryClientModule.h"
+#include "SentrySizes.h"
+
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+namespace
+{
+	// Files that are never removed: crashpad and sentry-native bookkeeping, and our own
+	bool IsProtected(const FString& Filename)
+	{
+		return Filename == TEXT("settings.dat") ||
+			Filename == TEXT("metadata") ||
+			Filename == TEXT("last_crash") ||
+			Filename == TEXT("crash-history.txt") ||
+			(Filename.StartsWith(TEXT("journal-")) && Filename.EndsWith(TEXT(".bin"))) ||
+			(Filename.StartsWith(TEXT("sessions-")) && Filename.EndsWith(TEXT(".txt"))) ||
+			Filename.EndsWith(TEXT(".lock"));
+	}
+
+	// Files which belong together and are removed together, e.g. the
+	// minidump, metadata and attachments of a crashpad report, or a run folder.
+	struct FReportGroup
+	{
+		TArray<FString> Files;
+		FString Directory;	// removed as well, if set
+		int64 Size = 0;
+		FDateTime Newest = FDateTime::MinValue();
+	};
+
+	class FCollectVisitor : public IPlatformFile::FDirectoryStatVisitor
+	{
+	public:
+		FCollectVisitor(const FString& InRoot, const FDateTime& InStartTime)
+			: Root(InRoot), StartTime(InStartTime) {}
+
+		virtual bool Visit(const TCHAR* FilenameOrDirectory, const FFileStatData& StatData) override
+		{
+			if (StatData.bIsDirectory)
+			{
+				return true;
+			}
+			FString Path(FilenameOrDirectory);
+			const FString Filename = FPaths::GetCleanFilename(Path);
+			TotalSize += StatData.FileSize;
+			// anything written since we started belongs to this run
+			if (IsProtected(Filename) || StatData.ModificationTime >= StartTime)
+			{
+				return true;
+			}
+
+			FString Relative = Path;
+			FPaths::MakePathRelativeTo(Relative, *(Root / TEXT("")));
+			TArray<FString> Parts;
+			Relative.ParseIntoArray(Parts, TEXT("/"));
+
+			// <uuid>.run/..., attachments/<uuid>/... or <uuid>.dmp / <uuid>.meta
+			FString Key, Directory;
+			for (int32 i = 0; i < Parts.Num() - 1 && Key.IsEmpty(); i++)
+			{
+				if (Parts[i].EndsWith(TEXT(".run")))
+				{
+					Key = Parts[i];
+					Directory = FString::Join(TArray<FString>(Parts.GetData(), i + 1), TEXT("/"));
+				}
+				else if (Parts[i] == TEXT("attachments") && i + 1 < Parts.Num() - 1)
+				{
+					Key = Parts[i + 1];
+					Directory = FString::Join(TArray<FString>(Parts.GetData(), i + 2), TEXT("/"));
+				}
+			}
+			if (Key.IsEmpty())
+			{
+				Key = FPaths::GetBaseFilename(Filename);
+			}
+
+			FReportGroup& Group = Groups.FindOrAdd(Key);
+			Group.Files.Add(Path);
+			if (!Directory.IsEmpty())
+			{
+				Group.Directory = Root / Directory;
+			}
+			Group.Size += StatData.FileSize;
+			Group.Newest = FMath::Max(Group.Newest, StatData.ModificationTime);
+			return true;
+		}
+
+		FString Root;
+		FDateTime StartTime;
+		int64 TotalSize = 0;
+		TMap<FString, FReportGroup> Groups;
+	};
+}
+
+FSentryDatabasePruner::FSentryDatabasePruner(const FString& InDatabasePath)
+	: DatabasePath(InDatabasePath)
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	MaxSize = FMath::Max(0, USentryClientConfig::GetConfigInt(TEXT("DATABASE_MAX_SIZE_MB"), Config->DatabaseMaxSizeMB)) * MB;
+	MaxAge = USentryClientConfig::GetConfigFloat(TEXT("DATABASE_MAX_AGE_DAYS"), Config->DatabaseMaxAgeDays) * 24.0 * 3600.0;
+	Interval = USentryClientConfig::GetConfigFloat(TEXT("DATABASE_PRUNE_INTERVAL"), Config->DatabasePruneInterval);
+
+	// file times from the file system are in UTC
+	ProcessStartTime = FDateTime::UtcNow() - FTimespan::FromSeconds(FPlatformTime::Seconds() - GStartTime);
+
+	// first prune right away
+	LastPruneTime = -Interval;
+	Tick();
+}
+
+FSentryDatabasePruner::~FSentryDatabasePruner()
+{
+	if (Task.IsValid())
+	{
+		Task.Wait();
+	}
+}
+
+void FSentryDatabasePruner::Tick()
+{
+	if (MaxSize <= 0 && MaxAge <= 0.0)
+	{
+		return;
+	}
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastPruneTime < Interval || (Task.IsValid() && !Task.IsReady()))
+	{
+		return;
+	}
+	LastPruneTime = Now;
+	Task = Async(EAsyncExecution::ThreadPool, [this]() { Prune(); });
+}
+
+void FSentryDatabasePruner::Prune() const
+{
+	const double Start = FPlatformTime::Seconds();
+	FCollectVisitor Visitor(DatabasePath, ProcessStartTime);
+	FPlatformFileManager::Get().GetPlatformFile().IterateDirectoryStatRecursively(*DatabasePath, Visitor);
+
+	// oldest first
+	TArray<FReportGroup> Groups;
+	Visitor.Groups.GenerateValueArray(Groups);
+	Groups.Sort([](const FReportGroup& A, const FReportGroup& B) { return A.Newest < B.Newest; });
+
+	const FDateTime Cutoff = FDateTime::UtcNow() - FTimespan::FromSeconds(MaxAge);
+	int64 Size = Visitor.TotalSize;
+	int32 Removed = 0;
+	int64 RemovedSize = 0;
+	for (const FReportGroup& Group : Groups)
+	{
+		const bool bTooOld = MaxAge > 0.0 && Group.Newest < Cutoff;
+		const bool bTooBig = MaxSize > 0 && Size > MaxSize;
+		if (!bTooOld && !bTooBig)
+		{
+			// the rest is newer
+			break;
+		}
+		for (const FString& File : Group.Files)
+		{
+			IFileManager::Get().Delete(*File, false, false, true);
+		}
+		if (!Group.Directory.IsEmpty())
+		{
+			IFileManager::Get().DeleteDirectory(*Group.Directory, false, true);
+		}
+		Size -= Group.Size;
+		RemovedSize += Group.Size;
+		Removed++;
+	}
+
+	if (Removed > 0)
+	{
+		UE_LOG(LogSentryClient, Log, TEXT("Pruned %d reports (%lld kB) from the database in %.1f ms, %lld kB left"),
+			Removed, RemovedSize / 1024, (FPlatformTime::Seconds() - Start) * 1000.0, Size / 1024);
+	}
+	if (MaxSize > 0 && Size > MaxSize)
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("Database is %lld kB after pruning, above the limit of %lld kB"), Size / 1024, MaxSize / 1024);
+	}
+}
+
+FString FSentryDatabasePruner::SelectDatabasePath(const FString& Candidates, int32 MaxSizeMB)
+{
+	TArray<FString> Paths;
+	Candidates.ParseIntoArray(Paths, TEXT(";"), true);
+	for (FString& Path : Paths)
+	{
+		Path.TrimStartAndEndInline();
+		if (!IFileManager::Get().MakeDirectory(*Path, true))
+		{
+			UE_LOG(LogSentryClient, Log, TEXT("Database path %s cannot be created"), *Path);
+			continue;
+		}
+		const FString Probe = Path / TEXT(".write-test");
+		if (!FFileHelper::SaveStringToFile(TEXT(""), *Probe))
+		{
+			UE_LOG(LogSentryClient, Log, TEXT("Database path %s is not writable"), *Path);
+			continue;
+		}
+		IFileManager::Get().Delete(*Probe, false, false, true);
+
+		uint64 Total = 0, Free = 0;
+		if (MaxSizeMB > 0 && FPlatformMisc::GetDiskTotalAndFreeSpace(Path, Total, Free) && Free < (uint64)MaxSizeMB * MB)
+		{
+			UE_LOG(LogSentryClient, Log, TEXT("Database path %s has only %llu MB free"), *Path, Free / MB);
+			continue;
+		}
+		return Path;
+	}
+	return FString();
+}
+
+#endif // SENTRY_HAVE_PLATFORM
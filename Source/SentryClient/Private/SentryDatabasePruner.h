@@ -0,0 +1,40 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+// Keeps the sentry database folder within a size and age limit.  Pending crash
+// reports, old run folders and their attachments are removed, oldest first, on a
+// background task at startup and then periodically.  Files belonging to the
+// current run and the bookkeeping files of the backend and the plugin are left alone.
+class FSentryDatabasePruner
+{
+public:
+	FSentryDatabasePruner(const FString& DatabasePath);
+	~FSentryDatabasePruner();
+
+	// Start a prune if the interval has passed.  Call on the game thread.
+	void Tick();
+
+	// Pick the first usable folder from a ';' separated list, e.g. a tmpfs mount followed
+	// by a folder on disk.  A folder is usable if it can be written to and has room for MaxSizeMB.
+	static FString SelectDatabasePath(const FString& Candidates, int32 MaxSizeMB);
+
+private:
+	void Prune() const;
+
+	FString DatabasePath;
+	int64 MaxSize = 0;
+	double MaxAge = 0.0;	// seconds
+	double Interval = 0.0;
+
+	FDateTime ProcessStartTime;
+	double LastPruneTime = 0.0;
+	TFuture<void> Task;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "SentryEnsureReporter.h"
+#include "SentryClientModule.h"
+#include "SentryStackTrace.h"
+
+#include "Hash/CityHash.h"
+#include "Misc/ScopeLock.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+// the engine logs failed ensures with this prefix (see FDebug::EnsureFailed)
+static const TCHAR* EnsurePrefix = TEXT("Ensure condition failed:");
+
+FSentryEnsureReporter::FSentryEnsureReporter()
+{
+	bSymbolicate = USentryClientConfig::GetConfigBool(TEXT("ENSURE_SYMBOLICATION"), USentryClientConfig::Get()->EnsureSymbolication);
+}
+
+bool FSentryEnsureReporter::IsEnsureMessage(const TCHAR* Msg)
+{
+	return FCString::Strncmp(Msg, EnsurePrefix, FCString::Strlen(EnsurePrefix)) == 0;
+}
+
+void FSentryEnsureReporter::OnEnsure(const TCHAR* Msg)
+{
+	// capturing the event may log, don't recurse
+	static thread_local bool bInEnsure = false;
+	if (bInEnsure)
+	{
+		return;
+	}
+	TGuardValue<bool> Guard(bInEnsure, true);
+
+	// only the first line, the rest is usually a callstack dump.  It holds the expression, file
+	// and line of the ensure, which identify it.
+	FString Message(Msg);
+	int32 LineEnd;
+	if (Message.FindChar(TEXT('\n'), LineEnd))
+	{
+		Message.LeftInline(LineEnd);
+	}
+	Message.TrimEndInline();
+	const FTCHARToUTF8 Utf8Message(*Message);
+	const uint64 Callsite = CityHash64((const char*)Utf8Message.Get(), Utf8Message.Length());
+
+	uint32 Count = 0;
+	{
+		FScopeLock ScopeLock(&Lock);
+		uint32* Found = Callsites.Find(Callsite);
+		if (Found)
+		{
+			Count = ++(*Found);
+		}
+		else if (Callsites.Num() < MaxCallsites)
+		{
+			Callsites.Add(Callsite, 1);
+			Count = 1;
+		}
+	}
+	// Unknown callsite after the table is full, or not a sampled occurrence
+	if (Count == 0 || !FMath::IsPowerOfTwo(Count))
+	{
+		return;
+	}
+
+	void* ips[FSentryStackTrace::MaxFrames];
+	const size_t NumFrames = sentry_unwind_stack(nullptr, ips, FSentryStackTrace::MaxFrames);
+
+	sentry_value_t event = sentry_value_new_event();
+	sentry_value_set_by_key(event, "level", sentry_value_new_string("warning"));
+	sentry_value_set_by_key(event, "logger", sentry_value_new_string("ensure"));
+
+	sentry_value_t exception = sentry_value_new_exception("Ensure", Utf8Message.Get());
+	sentry_value_t mechanism = sentry_value_new_object();
+	sentry_value_set_by_key(mechanism, "type", sentry_value_new_string("ensure"));
+	sentry_value_set_by_key(mechanism, "handled", sentry_value_new_bool(1));
+	sentry_value_set_by_key(exception, "mechanism", mechanism);
+
+	sentry_value_t stacktrace = sentry_value_new_stacktrace(ips, NumFrames);
+	if (bSymbolicate)
+	{
+		FSentryStackTrace::Symbolicate(stacktrace);
+	}
+	sentry_value_set_by_key(exception, "stacktrace", stacktrace);
+	sentry_event_add_exception(event, exception);
+
+	sentry_value_t extra = sentry_value_new_object();
+	sentry_value_set_by_key(extra, "occurrences", sentry_value_new_int32((int32_t)Count));
+	sentry_value_set_by_key(event, "extra", extra);
+
+	sentry_capture_event(event);
+}
+
+#endif // SENTRY_HAVE_PLATFORM
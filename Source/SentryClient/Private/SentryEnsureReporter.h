@@ -0,0 +1,37 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+// Captures failed ensure() conditions as non-fatal sentry events.
+// The ensure is identified by its callsite, the expression, file and line which the
+// engine logs, whichever code called it.  The first
+// failure of each is reported, and after that only the 2nd, 4th, 8th ...
+// occurrence, so that an ensure failing every tick doesn't flood sentry.
+class FSentryEnsureReporter
+{
+public:
+	FSentryEnsureReporter();
+
+	// is this log line the message of a failed ensure?
+	static bool IsEnsureMessage(const TCHAR* Msg);
+
+	// Called on the thread where the ensure failed
+	void OnEnsure(const TCHAR* Msg);
+
+private:
+	// number of distinct ensures we keep track of
+	static constexpr int32 MaxCallsites = 1024;
+
+	bool bSymbolicate = false;
+
+	// occurrences per callsite
+	TMap<uint64, uint32> Callsites;
+	FCriticalSection Lock;
+};
+
+#endif
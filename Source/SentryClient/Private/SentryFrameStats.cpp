@@ -0,0 +1,89 @@
+#include "SentryFrameStats.h"
+#include "SentryClientModule.h"
+
+#include "HAL/PlatformTime.h"
+#include "UObject/UObjectGlobals.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentryFrameStats::FSentryFrameStats()
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	Interval = FMath::Max(10.0f, USentryClientConfig::GetConfigFloat(TEXT("FRAME_STATS_INTERVAL"), Config->FrameStatsInterval));
+	HitchThreshold = (uint64)(USentryClientConfig::GetConfigFloat(TEXT("FRAME_HITCH_THRESHOLD"), Config->FrameHitchThreshold) * 1000.0f);
+
+	// the frame spanning a blocking map load is not a hitch
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &FSentryFrameStats::OnPreLoadMap);
+	IntervalStart = FPlatformTime::Seconds();
+}
+
+FSentryFrameStats::~FSentryFrameStats()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+}
+
+void FSentryFrameStats::OnPreLoadMap(const FString& MapName)
+{
+	LastFrameCycles = 0;
+}
+
+void FSentryFrameStats::Tick()
+{
+	const uint64 Now = FPlatformTime::Cycles64();
+	if (LastFrameCycles != 0)
+	{
+		const uint64 Micros = (uint64)(FPlatformTime::ToSeconds64(Now - LastFrameCycles) * 1000000.0);
+		FrameTimes.Record(Micros);
+		if (Micros >= HitchThreshold)
+		{
+			Hitches++;
+		}
+	}
+	LastFrameCycles = Now;
+
+	const double Elapsed = FPlatformTime::Seconds() - IntervalStart;
+	if (Elapsed >= Interval)
+	{
+		Report(Elapsed);
+		FrameTimes.Reset();
+		Hitches = 0;
+		IntervalStart = FPlatformTime::Seconds();
+	}
+}
+
+void FSentryFrameStats::Report(double Elapsed)
+{
+	if (FrameTimes.GetCount() == 0)
+	{
+		return;
+	}
+
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_INFO, "sentry.frametime", "Frame time report");
+
+	sentry_value_t stats = sentry_value_new_object();
+	sentry_value_set_by_key(stats, "type", sentry_value_new_string("frame_time"));
+	sentry_value_set_by_key(stats, "frames", sentry_value_new_int32((int32_t)FrameTimes.GetCount()));
+	sentry_value_set_by_key(stats, "seconds", sentry_value_new_double(Elapsed));
+	sentry_value_set_by_key(stats, "fps", sentry_value_new_double(FrameTimes.GetCount() / Elapsed));
+	sentry_value_set_by_key(stats, "mean_ms", sentry_value_new_double(FrameTimes.GetMean() / 1000.0));
+	sentry_value_set_by_key(stats, "p50_ms", sentry_value_new_double(FrameTimes.GetPercentile(0.50) / 1000.0));
+	sentry_value_set_by_key(stats, "p95_ms", sentry_value_new_double(FrameTimes.GetPercentile(0.95) / 1000.0));
+	sentry_value_set_by_key(stats, "p99_ms", sentry_value_new_double(FrameTimes.GetPercentile(0.99) / 1000.0));
+	sentry_value_set_by_key(stats, "max_ms", sentry_value_new_double(FrameTimes.GetMax() / 1000.0));
+	sentry_value_set_by_key(stats, "hitches", sentry_value_new_int32((int32_t)Hitches));
+	sentry_value_set_by_key(stats, "hitch_threshold_ms", sentry_value_new_double(HitchThreshold / 1000.0));
+
+	sentry_value_t contexts = sentry_value_new_object();
+	sentry_value_set_by_key(contexts, "frame_time", stats);
+	sentry_value_set_by_key(event, "contexts", contexts);
+
+	// all reports are one issue, filter and chart them by map and build tags
+	sentry_value_t fingerprint = sentry_value_new_list();
+	sentry_value_append(fingerprint, sentry_value_new_string("frame-time-report"));
+	sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+	sentry_capture_event(event);
+}
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "SentryHistogram.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+// Collects frame times in a histogram and periodically sends a compact report
+// with percentiles and the number of hitches, instead of any per frame data.
+class FSentryFrameStats
+{
+public:
+	FSentryFrameStats();
+	~FSentryFrameStats();
+
+	// Call on the game thread, once per frame
+	void Tick();
+
+private:
+	void OnPreLoadMap(const FString& MapName);
+	void Report(double Elapsed);
+
+	// configuration
+	double Interval = 300.0;
+	uint64 HitchThreshold = 100000;	// microseconds
+
+	// frame times in microseconds
+	FSentryHistogram FrameTimes;
+	uint32 Hitches = 0;
+
+	uint64 LastFrameCycles = 0;
+	double IntervalStart = 0.0;
+
+	FDelegateHandle PreLoadMapHandle;
+};
+
+#endif
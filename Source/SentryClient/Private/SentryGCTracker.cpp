@@ -0,0 +1,97 @@
+#include "SentryGCTracker.h"
+#include "SentryClientModule.h"
+#include "SentryTracing.h"
+
+#include "HAL/PlatformTime.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectGlobals.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentryGCTracker::FSentryGCTracker()
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	Threshold = USentryClientConfig::GetConfigFloat(TEXT("GC_PAUSE_THRESHOLD"), Config->GCPauseThreshold) / 1000.0;
+	Cooldown = USentryClientConfig::GetConfigFloat(TEXT("GC_COOLDOWN"), Config->GCCooldown);
+
+	PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddRaw(this, &FSentryGCTracker::OnPreGarbageCollect);
+	PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FSentryGCTracker::OnPostGarbageCollect);
+}
+
+FSentryGCTracker::~FSentryGCTracker()
+{
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+}
+
+void FSentryGCTracker::OnPreGarbageCollect()
+{
+	StartCycles = FPlatformTime::Cycles64();
+}
+
+void FSentryGCTracker::OnPostGarbageCollect()
+{
+	if (StartCycles == 0)
+	{
+		return;
+	}
+	const double Pause = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+	StartCycles = 0;
+
+	// Without a full purge, unreachable objects are destroyed over the following frames
+	const char* Type = IsIncrementalPurgePending() ? "incremental_purge" : "full_purge";
+	const int32 Objects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	Pauses.Record((uint64)(Pause * 1000000.0));
+	UpdateContext();
+	FSentryTransaction::AddCurrentSpan(TEXT("gc"), UTF8_TO_TCHAR(Type), Pause);
+
+	if (Pause >= Threshold)
+	{
+		const double Now = FPlatformTime::Seconds();
+		if (LastReportTime >= 0.0 && Now - LastReportTime < Cooldown)
+		{
+			UE_LOG(LogSentryClient, Log, TEXT("Garbage collection took %.1f ms, not reported (cooldown)"), Pause * 1000.0);
+			return;
+		}
+		LastReportTime = Now;
+		ReportLongPause(Pause, Objects, Type);
+	}
+}
+
+void FSentryGCTracker::UpdateContext()
+{
+	sentry_value_t gc = sentry_value_new_object();
+	sentry_value_set_by_key(gc, "type", sentry_value_new_string("gc"));
+	sentry_value_set_by_key(gc, "collections", sentry_value_new_int32((int32_t)Pauses.GetCount()));
+	sentry_value_set_by_key(gc, "mean_ms", sentry_value_new_double(Pauses.GetMean() / 1000.0));
+	sentry_value_set_by_key(gc, "p50_ms", sentry_value_new_double(Pauses.GetPercentile(0.50) / 1000.0));
+	sentry_value_set_by_key(gc, "p95_ms", sentry_value_new_double(Pauses.GetPercentile(0.95) / 1000.0));
+	sentry_value_set_by_key(gc, "max_ms", sentry_value_new_double(Pauses.GetMax() / 1000.0));
+	sentry_set_context("gc", gc);
+}
+
+void FSentryGCTracker::ReportLongPause(double Pause, int32 Objects, const char* Type)
+{
+	UE_LOG(LogSentryClient, Warning, TEXT("Garbage collection took %.1f ms, reporting"), Pause * 1000.0);
+
+	FString Message = FString::Printf(TEXT("Long garbage collection (%.0f ms)"), Pause * 1000.0);
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_WARNING, "sentry.gc", TCHAR_TO_UTF8(*Message));
+
+	sentry_value_t extra = sentry_value_new_object();
+	sentry_value_set_by_key(extra, "pause_ms", sentry_value_new_double(Pause * 1000.0));
+	sentry_value_set_by_key(extra, "threshold_ms", sentry_value_new_double(Threshold * 1000.0));
+	sentry_value_set_by_key(extra, "uobjects", sentry_value_new_int32(Objects));
+	sentry_value_set_by_key(extra, "gc_type", sentry_value_new_string(Type));
+	sentry_value_set_by_key(event, "extra", extra);
+
+	// one issue for all of them, the pauses are in the extra data
+	sentry_value_t fingerprint = sentry_value_new_list();
+	sentry_value_append(fingerprint, sentry_value_new_string("long-garbage-collection"));
+	sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+	sentry_capture_event(event);
+}
+
+#endif // SENTRY_HAVE_PLATFORM
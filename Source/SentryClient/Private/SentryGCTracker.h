@@ -0,0 +1,40 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "SentryHistogram.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+// Measures garbage collection pauses, from the pre to the post garbage collect delegate.
+// Pauses go into a histogram, summarized in the gc context of all events, and become
+// gc spans of the current transaction.  A pause longer than the threshold is sent as a
+// "Long garbage collection" event, limited by a cooldown.
+class FSentryGCTracker
+{
+public:
+	FSentryGCTracker();
+	~FSentryGCTracker();
+
+private:
+	void OnPreGarbageCollect();
+	void OnPostGarbageCollect();
+
+	void UpdateContext();
+	void ReportLongPause(double Pause, int32 Objects, const char* Type);
+
+	// configuration
+	double Threshold = 0.05;
+	double Cooldown = 300.0;
+
+	// pauses in microseconds
+	FSentryHistogram Pauses;
+	uint64 StartCycles = 0;
+	double LastReportTime = -1.0;
+
+	FDelegateHandle PreGarbageCollectHandle;
+	FDelegateHandle PostGarbageCollectHandle;
+};
+
+#endif
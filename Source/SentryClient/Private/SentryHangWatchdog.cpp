@@ -0,0 +1,168 @@
+#include "SentryHangWatchdog.h"
+#include "SentryClientModule.h"
+#include "SentryStackTrace.h"
+
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformTLS.h"
+#include "HAL/RunnableThread.h"
+#include "UObject/UObjectGlobals.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentryHangWatchdog::FSentryHangWatchdog()
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	Threshold = FMath::Max(0.1f, USentryClientConfig::GetConfigFloat(TEXT("HANG_THRESHOLD"), Config->HangThreshold));
+	Cooldown = USentryClientConfig::GetConfigFloat(TEXT("HANG_COOLDOWN"), Config->HangCooldown);
+
+	if (USentryClientConfig::GetConfigBool(TEXT("HANG_IGNORE_MAP_LOAD"), Config->HangIgnoreMapLoad))
+	{
+		PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &FSentryHangWatchdog::OnPreLoadMap);
+		PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FSentryHangWatchdog::OnPostLoadMap);
+	}
+}
+
+FSentryHangWatchdog::~FSentryHangWatchdog()
+{
+	Shutdown();
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+}
+
+void FSentryHangWatchdog::Start()
+{
+	if (Thread)
+	{
+		return;
+	}
+	bStopping = false;
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("SentryHangWatchdog"), 64 * 1024, TPri_BelowNormal);
+	UE_LOG(LogSentryClient, Log, TEXT("Hang detection started, threshold %.1fs"), Threshold);
+}
+
+void FSentryHangWatchdog::Shutdown()
+{
+	if (!Thread)
+	{
+		return;
+	}
+	// Kill() calls Stop() and waits for Run() to return
+	Thread->Kill(true);
+	delete Thread;
+	Thread = nullptr;
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
+}
+
+void FSentryHangWatchdog::Heartbeat()
+{
+	HeartbeatCycles.store(FPlatformTime::Cycles64(), std::memory_order_relaxed);
+	HeartbeatCount.fetch_add(1, std::memory_order_release);
+}
+
+void FSentryHangWatchdog::OnPreLoadMap(const FString& MapName)
+{
+	bPaused = true;
+}
+
+void FSentryHangWatchdog::OnPostLoadMap(UWorld* World)
+{
+	Heartbeat();
+	bPaused = false;
+}
+
+uint32 FSentryHangWatchdog::Run()
+{
+	// poll a few times per threshold period
+	const uint32 IntervalMs = (uint32)FMath::Clamp(Threshold * 250.0, 10.0, 500.0);
+
+	while (!bStopping)
+	{
+		WakeEvent->Wait(IntervalMs);
+		if (bStopping)
+		{
+			break;
+		}
+
+		const uint64 Count = HeartbeatCount.load(std::memory_order_acquire);
+		if (Count == 0)
+		{
+			// no frame yet
+			continue;
+		}
+
+		// has the game thread moved on from a previously detected stall?
+		if (bStallReported && Count != ReportedCount)
+		{
+			bStallReported = false;
+		}
+		if (bStallReported || bPaused || FPlatformMisc::IsDebuggerPresent())
+		{
+			continue;
+		}
+
+		const double Stall = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - HeartbeatCycles.load(std::memory_order_relaxed));
+		if (Stall < Threshold)
+		{
+			continue;
+		}
+
+		// one decision per stall, whether reported or suppressed by the cooldown
+		bStallReported = true;
+		ReportedCount = Count;
+
+		const double Now = FPlatformTime::Seconds();
+		if (LastReportTime >= 0.0 && Now - LastReportTime < Cooldown)
+		{
+			UE_LOG(LogSentryClient, Log, TEXT("Game thread stalled for %.1fs, not reported (cooldown)"), Stall);
+			continue;
+		}
+		LastReportTime = Now;
+		ReportHang(Stall);
+	}
+	return 0;
+}
+
+void FSentryHangWatchdog::Stop()
+{
+	bStopping = true;
+	WakeEvent->Trigger();
+}
+
+void FSentryHangWatchdog::ReportHang(double StallSeconds)
+{
+	UE_LOG(LogSentryClient, Warning, TEXT("Game thread stalled for %.1fs, reporting hang"), StallSeconds);
+
+	sentry_value_t event = sentry_value_new_event();
+	sentry_value_set_by_key(event, "level", sentry_value_new_string("error"));
+	sentry_value_set_by_key(event, "logger", sentry_value_new_string("sentry.watchdog"));
+
+	sentry_value_t GameThreadStack = sentry_value_new_null();
+	FSentryStackTrace::AddAllThreads(event, FPlatformTLS::GetCurrentThreadId(), &GameThreadStack);
+
+	FString Message = FString::Printf(TEXT("Game thread unresponsive for at least %.1f seconds"), StallSeconds);
+	sentry_value_t exception = sentry_value_new_exception("App Hanging", TCHAR_TO_UTF8(*Message));
+	sentry_value_t mechanism = sentry_value_new_object();
+	sentry_value_set_by_key(mechanism, "type", sentry_value_new_string("AppHang"));
+	sentry_value_set_by_key(mechanism, "handled", sentry_value_new_bool(1));
+	sentry_value_set_by_key(exception, "mechanism", mechanism);
+	sentry_value_set_by_key(exception, "thread_id", sentry_value_new_int32((int32_t)GGameThreadId));
+	if (!sentry_value_is_null(GameThreadStack))
+	{
+		sentry_value_set_by_key(exception, "stacktrace", GameThreadStack);
+	}
+	sentry_event_add_exception(event, exception);
+
+	sentry_value_t extra = sentry_value_new_object();
+	sentry_value_set_by_key(extra, "stall_seconds", sentry_value_new_double(StallSeconds));
+	sentry_value_set_by_key(extra, "threshold_seconds", sentry_value_new_double(Threshold));
+	sentry_value_set_by_key(event, "extra", extra);
+
+	sentry_capture_event(event);
+}
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+#include <atomic>
+
+#if SENTRY_HAVE_PLATFORM
+
+class FRunnableThread;
+class FEvent;
+class UWorld;
+
+// A watchdog thread which monitors a game thread heartbeat.  When the game thread
+// has not completed a frame for longer than the configured threshold, the stacks
+// of the game thread and all other known threads are captured and sent as an
+// "App Hanging" event.  Each stall is reported at most once, and a cooldown
+// limits how often reports can be sent.
+class FSentryHangWatchdog : public FRunnable
+{
+public:
+	FSentryHangWatchdog();
+	virtual ~FSentryHangWatchdog();
+
+	void Start();
+	// stop the thread and wait for it to exit
+	void Shutdown();
+
+	// Called on the game thread, once per frame
+	void Heartbeat();
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	void OnPreLoadMap(const FString& MapName);
+	void OnPostLoadMap(UWorld* World);
+
+	void ReportHang(double StallSeconds);
+
+	// configuration
+	double Threshold = 5.0;
+	double Cooldown = 300.0;
+
+	// written by the game thread
+	std::atomic<uint64> HeartbeatCount{ 0 };
+	std::atomic<uint64> HeartbeatCycles{ 0 };
+	std::atomic<bool> bPaused{ false };
+
+	// only touched by the watchdog thread
+	uint64 ReportedCount = 0;
+	bool bStallReported = false;
+	double LastReportTime = -1.0;
+
+	std::atomic<bool> bStopping{ false };
+	FEvent* WakeEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// A fixed size histogram of integer values with a bounded relative error, in
+// the style of HdrHistogram.  Each power of two range is split into SubBuckets
+// linear buckets, so a value is recorded with about 1/SubBuckets precision.
+// Recording is a few instructions and never allocates.  Not thread safe.
+class FSentryHistogram
+{
+public:
+	// linear buckets per power of two
+	static constexpr int32 SubBucketBits = 4;
+	static constexpr int32 SubBuckets = 1 << SubBucketBits;
+	// values up to 2^MaxBits - 1 are recorded exactly, larger ones are clamped
+	static constexpr int32 MaxBits = 32;
+	static constexpr int32 NumBuckets = (MaxBits - SubBucketBits + 1) * SubBuckets;
+
+	FSentryHistogram() { Reset(); }
+
+	void Record(uint64 Value)
+	{
+		Value = FMath::Min<uint64>(Value, (1ull << MaxBits) - 1);
+		Counts[BucketIndex(Value)]++;
+		Count++;
+		Sum += Value;
+		Max = FMath::Max(Max, Value);
+	}
+
+	void Reset()
+	{
+		FMemory::Memzero(Counts);
+		Count = 0;
+		Sum = 0;
+		Max = 0;
+	}
+
+	uint64 GetCount() const { return Count; }
+	uint64 GetMax() const { return Max; }
+	double GetMean() const { return Count ? (double)Sum / Count : 0.0; }
+
+	// The value below which the given fraction (0-1) of the recorded values fall.
+	// Returns the upper bound of the bucket, so it doesn't underestimate.
+	uint64 GetPercentile(double Fraction) const
+	{
+		if (Count == 0)
+		{
+			return 0;
+		}
+		const uint64 Target = FMath::Max<uint64>(1, (uint64)FMath::CeilToDouble(Fraction * Count));
+		uint64 Seen = 0;
+		for (int32 i = 0; i < NumBuckets; i++)
+		{
+			Seen += Counts[i];
+			if (Seen >= Target)
+			{
+				return FMath::Min(BucketUpperBound(i), Max);
+			}
+		}
+		return Max;
+	}
+
+private:
+	// Values below SubBuckets get a bucket each.  Above that, the bucket is given by the
+	// position of the highest bit and the SubBucketBits bits below it.
+	static int32 BucketIndex(uint64 Value)
+	{
+		if (Value < SubBuckets)
+		{
+			return (int32)Value;
+		}
+		const int32 Shift = (int32)FMath::FloorLog2_64(Value) - SubBucketBits;
+		return (Shift + 1) * SubBuckets + (int32)((Value >> Shift) - SubBuckets);
+	}
+
+	static uint64 BucketUpperBound(int32 Index)
+	{
+		if (Index < SubBuckets)
+		{
+			return (uint64)Index;
+		}
+		const int32 Shift = Index / SubBuckets - 1;
+		const uint64 Lower = (uint64)(SubBuckets + Index % SubBuckets) << Shift;
+		return Lower + (1ull << Shift) - 1;
+	}
+
+	uint64 Counts[NumBuckets];
+	uint64 Count;
+	uint64 Sum;
+	uint64 Max;
+};
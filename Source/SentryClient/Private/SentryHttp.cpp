@@ -0,0 +1,112 @@
+#include "SentryHttp.h"
+#include "SentryClientModule.h"
+#include "SentryTracing.h"
+
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+
+
+namespace
+{
+	ESentrySpanStatus ToSpanStatus(int32 Code)
+	{
+		if (Code < 400)
+		{
+			return ESentrySpanStatus::Ok;
+		}
+		switch (Code)
+		{
+		case 400: return ESentrySpanStatus::InvalidArgument;
+		case 401: return ESentrySpanStatus::Unauthenticated;
+		case 403: return ESentrySpanStatus::PermissionDenied;
+		case 404: return ESentrySpanStatus::NotFound;
+		case 409: return ESentrySpanStatus::AlreadyExists;
+		case 429: return ESentrySpanStatus::ResourceExhausted;
+		case 499: return ESentrySpanStatus::Cancelled;
+		case 501: return ESentrySpanStatus::Unimplemented;
+		case 503: return ESentrySpanStatus::Unavailable;
+		case 504: return ESentrySpanStatus::DeadlineExceeded;
+		}
+		return Code < 500 ? ESentrySpanStatus::InvalidArgument : ESentrySpanStatus::InternalError;
+	}
+
+	// Should the trace headers be sent to this url?  Only to the configured targets, they
+	// would leak the trace and release to third party services.
+	bool IsPropagationTarget(const FString& Url)
+	{
+		static const TArray<FString> Targets = []()
+		{
+			TArray<FString> Result;
+			USentryClientConfig::GetConfig(TEXT("TRACE_PROPAGATION_TARGETS"), *USentryClientConfig::Get()->TracePropagationTargets).ParseIntoArray(Result, TEXT(","), true);
+			for (FString& Target : Result)
+			{
+				Target.TrimStartAndEndInline();
+			}
+			return Result;
+		}();
+		for (const FString& Target : Targets)
+		{
+			if (Url.Contains(Target))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+bool FSentryHttp::ProcessRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& Request)
+{
+	const FString Url = Request->GetURL();
+	// the query may hold secrets, keep it out of the span
+	FString Path = Url;
+	Path.Split(TEXT("?"), &Path, nullptr);
+
+	TSharedRef<FSentrySpan, ESPMode::ThreadSafe> Span = MakeShared<FSentrySpan, ESPMode::ThreadSafe>(
+		FSentryTransaction::StartCurrentChild(TEXT("http.client"), Request->GetVerb() + TEXT(" ") + Path));
+	if (!Span->IsValid())
+	{
+		return Request->ProcessRequest();
+	}
+	Span->SetData(TEXT("http.request.method"), Request->GetVerb());
+	Span->SetData(TEXT("url"), Path);
+
+	if (IsPropagationTarget(Url))
+	{
+		TArray<TPair<FString, FString>> Headers;
+		Span->GetTraceHeaders(Headers);
+		for (const TPair<FString, FString>& Header : Headers)
+		{
+			Request->SetHeader(Header.Key, Header.Value);
+		}
+	}
+
+	// finish the span before the caller's delegate runs, which may start the next request
+	FHttpRequestCompleteDelegate Complete = Request->OnProcessRequestComplete();
+	Request->OnProcessRequestComplete().BindLambda([Span, Complete](FHttpRequestPtr CompletedRequest, FHttpResponsePtr Response, bool bSucceeded)
+		{
+			if (bSucceeded && Response.IsValid())
+			{
+				const int32 Code = Response->GetResponseCode();
+				Span->SetData(TEXT("http.response.status_code"), (double)Code);
+				Span->SetData(TEXT("http.response_content_length"), (double)Response->GetContentLength());
+				Span->SetTag(TEXT("http.status_code"), FString::FromInt(Code));
+				Span->SetStatus(ToSpanStatus(Code));
+			}
+			else
+			{
+				// no response, the connection failed or the request was cancelled
+				Span->SetStatus(ESentrySpanStatus::Unavailable);
+			}
+			Span->Finish();
+			Complete.ExecuteIfBound(CompletedRequest, Response, bSucceeded);
+		});
+
+	if (!Request->ProcessRequest())
+	{
+		Span->SetStatus(ESentrySpanStatus::InvalidArgument);
+		Span->Finish();
+		return false;
+	}
+	return true;
+}
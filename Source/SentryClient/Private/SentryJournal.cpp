@@ -0,0 +1,335 @@
+#include "SentryJournal.h"
+#include "SentryClientModule.h"
+#include "SentryProcessFiles.h"
+
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformAtomics.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/WindowsHWrapper.h"
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+#if SENTRY_HAVE_PLATFORM
+
+// the file layout.  Bump the version when changing any of this.
+static const uint32 JournalMagic = 0x4A544E53;	// "SNTJ"
+static const uint32 JournalVersion = 1;
+
+enum EJournalState : uint32
+{
+	Clean = 0,
+	Running = 1,
+	Crashed = 2,
+};
+
+struct FSentryJournal::FHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 NumRecords;
+	volatile uint32 State;
+	uint32 ProcessId;
+	volatile int32 NextRecord;	// total number of records written, wraps around the ring
+	int64 StartTime;			// unix time, milliseconds
+	volatile int64 Heartbeat;	// unix time, milliseconds
+};
+
+struct FSentryJournal::FRecord
+{
+	int64 Timestamp;	// unix time, milliseconds
+	char Level[8];
+	char Category[48];
+	char Message[200];
+};
+
+std::atomic<FSentryJournal*> FSentryJournal::Active{ nullptr };
+std::atomic<int32> FSentryJournal::Writers{ 0 };
+
+static int64 NowMs()
+{
+	return (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTicks() / ETimespan::TicksPerMillisecond;
+}
+
+// copy a string into a fixed size field, always zero terminated
+static void CopyField(char* Dest, int32 Size, const char* Src)
+{
+	FCStringAnsi::Strncpy(Dest, Src, Size);
+}
+
+FSentryJournal::FSentryJournal(const FString& DatabasePath)
+{
+	NumRecords = FMath::Clamp(USentryClientConfig::GetConfigInt(TEXT("JOURNAL_RECORDS"),
+		USentryClientConfig::GetSetting(TEXT("JournalRecords"), &USentryClientConfig::JournalRecords, 256)), 16, 65536);
+
+	// Collect the journals of earlier runs which are gone, before this run's journal takes a file of the same name
+	IFileManager::Get().MakeDirectory(*DatabasePath, true);
+	for (const FString& Orphan : FSentryProcessFiles::ClaimOrphans(DatabasePath, TEXT("journal"), TEXT("bin")))
+	{
+		ReadPreviousRun(Orphan);
+		IFileManager::Get().Delete(*Orphan, false, false, true);
+	}
+
+	const FString Filename = FSentryProcessFiles::GetPath(DatabasePath, TEXT("journal"), TEXT("bin"));
+	if (!Map(Filename, sizeof(FHeader) + NumRecords * sizeof(FRecord)))
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("Could not map journal file %s"), *Filename);
+		return;
+	}
+
+	// start a fresh journal for this run
+	FMemory::Memzero(Records, NumRecords * sizeof(FRecord));
+	Header->Magic = JournalMagic;
+	Header->Version = JournalVersion;
+	Header->NumRecords = NumRecords;
+	Header->ProcessId = FPlatformProcess::GetCurrentProcessId();
+	Header->NextRecord = 0;
+	Header->StartTime = NowMs();
+	Header->Heartbeat = Header->StartTime;
+	Header->State = Running;
+
+	Active = this;
+}
+
+FSentryJournal::~FSentryJournal()
+{
+	// A writer registers before it loads the pointer, so once it is cleared, only the writers
+	// counted here can still be using the mapping
+	FSentryJournal* Expected = this;
+	Active.compare_exchange_strong(Expected, nullptr);
+	while (Writers.load() > 0)
+	{
+		FPlatformProcess::YieldThread();
+	}
+	for (FPreviousRun& Run : PreviousRuns)
+	{
+		for (auto& crumb : Run.Breadcrumbs)
+		{
+			sentry_value_decref(crumb);
+		}
+	}
+	// the file is only needed to find out about this run on the next start, if it didn't end
+	const bool bEnded = Header && Header->State != Running;
+	Unmap();
+	if (bEnded)
+	{
+		IFileManager::Get().Delete(*MappedFilename, false, false, true);
+	}
+}
+
+void FSentryJournal::ReadPreviousRun(const FString& Filename)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Filename, FILEREAD_Silent) || Data.Num() < (int32)sizeof(FHeader))
+	{
+		return;
+	}
+	FHeader Previous;
+	FMemory::Memcpy(&Previous, Data.GetData(), sizeof(FHeader));
+	if (Previous.Magic != JournalMagic || Previous.Version != JournalVersion || Previous.State != Running || Previous.NumRecords == 0)
+	{
+		return;
+	}
+
+	FPreviousRun& Run = PreviousRuns.AddDefaulted_GetRef();
+	Run.ProcessId = Previous.ProcessId;
+	Run.StartTime = Previous.StartTime;
+	Run.Heartbeat = Previous.Heartbeat;
+
+	// The ring has the size of the run which wrote it, JournalRecords may have changed since.
+	// Slots beyond the end of a truncated file are skipped.  Oldest first.
+	const FRecord* PreviousRecords = (const FRecord*)(Data.GetData() + sizeof(FHeader));
+	const uint32 Available = (uint32)((Data.Num() - sizeof(FHeader)) / sizeof(FRecord));
+	const uint32 Written = (uint32)Previous.NextRecord;
+	const uint32 Count = FMath::Min<uint32>(Written, Previous.NumRecords);
+	for (uint32 i = Written - Count; i < Written; i++)
+	{
+		const uint32 Slot = i % Previous.NumRecords;
+		if (Slot >= Available)
+		{
+			continue;
+		}
+		FRecord Copy = PreviousRecords[Slot];
+		Copy.Level[sizeof(Copy.Level) - 1] = 0;
+		Copy.Category[sizeof(Copy.Category) - 1] = 0;
+		Copy.Message[sizeof(Copy.Message) - 1] = 0;
+
+		sentry_value_t crumb = sentry_value_new_breadcrumb("debug", Copy.Message);
+		sentry_value_set_by_key(crumb, "category", sentry_value_new_string(Copy.Category));
+		sentry_value_set_by_key(crumb, "level", sentry_value_new_string(Copy.Level));
+		sentry_value_set_by_key(crumb, "timestamp", sentry_value_new_double((double)Copy.Timestamp / 1000.0));
+		Run.Breadcrumbs.Add(crumb);
+	}
+}
+
+void FSentryJournal::ReportPreviousRuns()
+{
+	for (FPreviousRun& Run : PreviousRuns)
+	{
+		const FDateTime Started = FDateTime::FromUnixTimestamp(Run.StartTime / 1000);
+		const FDateTime LastSeen = FDateTime::FromUnixTimestamp(Run.Heartbeat / 1000);
+		UE_LOG(LogSentryClient, Warning, TEXT("Previous run (pid %u) ended abnormally, last seen %s"), Run.ProcessId, *LastSeen.ToIso8601());
+
+		FString Message = FString::Printf(TEXT("Abnormal exit: process %u ended without shutting down, last seen %s"),
+			Run.ProcessId, *LastSeen.ToIso8601());
+		sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_FATAL, "sentry.journal", TCHAR_TO_UTF8(*Message));
+
+		sentry_value_t crumbs = sentry_value_new_list();
+		for (auto& crumb : Run.Breadcrumbs)
+		{
+			sentry_value_append(crumbs, crumb);
+		}
+		Run.Breadcrumbs.Empty();
+		sentry_value_set_by_key(event, "breadcrumbs", crumbs);
+
+		sentry_value_t extra = sentry_value_new_object();
+		sentry_value_set_by_key(extra, "process_id", sentry_value_new_int32((int32_t)Run.ProcessId));
+		sentry_value_set_by_key(extra, "started", sentry_value_new_string(TCHAR_TO_UTF8(*Started.ToIso8601())));
+		sentry_value_set_by_key(extra, "last_heartbeat", sentry_value_new_string(TCHAR_TO_UTF8(*LastSeen.ToIso8601())));
+		sentry_value_set_by_key(extra, "uptime_seconds", sentry_value_new_double((double)(Run.Heartbeat - Run.StartTime) / 1000.0));
+		sentry_value_set_by_key(event, "extra", extra);
+
+		// all abnormal exits are grouped together
+		sentry_value_t fingerprint = sentry_value_new_list();
+		sentry_value_append(fingerprint, sentry_value_new_string("abnormal-exit"));
+		sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+		sentry_capture_event(event);
+	}
+	PreviousRuns.Empty();
+}
+
+void FSentryJournal::AddActiveBreadcrumb(const ANSICHAR* Level, const FName& Category, const TCHAR* Message)
+{
+	Writers.fetch_add(1);
+	if (FSentryJournal* Journal = Active.load())
+	{
+		Journal->AddBreadcrumb(Level, *Category.ToString(), Message);
+	}
+	Writers.fetch_sub(1);
+}
+
+void FSentryJournal::AddBreadcrumb(const ANSICHAR* Level, const TCHAR* Category, const TCHAR* Message)
+{
+	const int32 Index = FPlatformAtomics::InterlockedIncrement(&Header->NextRecord) - 1;
+	FRecord& Record = Records[(uint32)Index % (uint32)NumRecords];
+	Record.Timestamp = NowMs();
+	CopyField(Record.Level, sizeof(Record.Level), Level ? Level : "");
+	CopyField(Record.Category, sizeof(Record.Category), TCHAR_TO_UTF8(Category));
+	CopyField(Record.Message, sizeof(Record.Message), TCHAR_TO_UTF8(Message));
+}
+
+void FSentryJournal::Tick()
+{
+	if (!Header)
+	{
+		return;
+	}
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastHeartbeat >= 1.0)
+	{
+		LastHeartbeat = Now;
+		Header->Heartbeat = NowMs();
+	}
+}
+
+void FSentryJournal::MarkClean()
+{
+	if (!Header)
+	{
+		return;
+	}
+	Header->Heartbeat = NowMs();
+	Header->State = Clean;
+}
+
+void FSentryJournal::MarkCrashed()
+{
+	if (!Header)
+	{
+		return;
+	}
+	Header->State = Crashed;
+}
+
+bool FSentryJournal::Map(const FString& Filename, int64 Size)
+{
+#if PLATFORM_WINDOWS
+	HANDLE File = CreateFileW(*Filename, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	HANDLE Mapping = CreateFileMappingW(File, nullptr, PAGE_READWRITE, (DWORD)(Size >> 32), (DWORD)Size, nullptr);
+	if (!Mapping)
+	{
+		CloseHandle(File);
+		return false;
+	}
+	void* Memory = MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)Size);
+	if (!Memory)
+	{
+		CloseHandle(Mapping);
+		CloseHandle(File);
+		return false;
+	}
+	FileHandle = File;
+	MappingHandle = Mapping;
+#else
+	int File = open(TCHAR_TO_UTF8(*Filename), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (File < 0)
+	{
+		return false;
+	}
+	// zero filled
+	if (ftruncate(File, Size) != 0)
+	{
+		close(File);
+		return false;
+	}
+	void* Memory = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+	if (Memory == MAP_FAILED)
+	{
+		close(File);
+		return false;
+	}
+	FileHandle = File;
+#endif
+	MappedSize = Size;
+	MappedFilename = Filename;
+	Header = (FHeader*)Memory;
+	Records = (FRecord*)(Header + 1);
+	return true;
+}
+
+void FSentryJournal::Unmap()
+{
+	if (!Header)
+	{
+		return;
+	}
+#if PLATFORM_WINDOWS
+	UnmapViewOfFile(Header);
+	CloseHandle((HANDLE)MappingHandle);
+	CloseHandle((HANDLE)FileHandle);
+	MappingHandle = nullptr;
+	FileHandle = nullptr;
+#else
+	munmap(Header, MappedSize);
+	close(FileHandle);
+	FileHandle = -1;
+#endif
+	Header = nullptr;
+	Records = nullptr;
+}
+
+#endif // SENTRY_HAVE_PLATFORM
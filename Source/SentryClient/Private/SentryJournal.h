@@ -0,0 +1,82 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+#if SENTRY_HAVE_PLATFORM
+
+// A small memory mapped file in the database folder, holding a ring of the latest
+// breadcrumbs and a heartbeat.  It is marked clean when sentry is closed in an orderly
+// way, and as crashed by the crash handler.  If the process is killed instead (OOM killer,
+// container eviction, ...) the file stays in the running state, and on the next start
+// an "abnormal exit" event is sent with the breadcrumbs and the time of the last heartbeat.
+// Writing only involves plain stores into the mapping, the kernel takes care of the rest.
+// Each process has its own file, only the files of processes which are gone are read.
+class FSentryJournal
+{
+public:
+	FSentryJournal(const FString& DatabasePath);
+	~FSentryJournal();
+
+	// Append a breadcrumb to the journal, if there is one.  Can be called from any thread, also
+	// while the journal is destroyed, which waits for the writers in flight before unmapping.
+	static void AddActiveBreadcrumb(const ANSICHAR* Level, const FName& Category, const TCHAR* Message);
+
+	// False if the file could not be mapped, the previous runs can still be reported
+	bool IsValid() const { return Header != nullptr; }
+
+	// Send an event about each previous run which ended abnormally.  Call after sentry_init.
+	void ReportPreviousRuns();
+
+	// Update the heartbeat, at most once a second.  Call on the game thread.
+	void Tick();
+
+	// Mark the end of this run
+	void MarkClean();
+	void MarkCrashed();
+
+private:
+	struct FHeader;
+	struct FRecord;
+
+	// Collect the data of a previous run from its journal, if it ended abnormally
+	void ReadPreviousRun(const FString& Filename);
+
+	bool Map(const FString& Filename, int64 Size);
+	void Unmap();
+
+	void AddBreadcrumb(const ANSICHAR* Level, const TCHAR* Category, const TCHAR* Message);
+
+	// the journal breadcrumbs are written to, and the number of threads which may be writing to it
+	static std::atomic<FSentryJournal*> Active;
+	static std::atomic<int32> Writers;
+
+	FHeader* Header = nullptr;
+	FRecord* Records = nullptr;
+	int32 NumRecords = 0;
+	int64 MappedSize = 0;
+	FString MappedFilename;
+#if PLATFORM_WINDOWS
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+#else
+	int FileHandle = -1;
+#endif
+
+	// the previous runs which didn't exit cleanly
+	struct FPreviousRun
+	{
+		uint32 ProcessId = 0;
+		int64 StartTime = 0;
+		int64 Heartbeat = 0;
+		TArray<sentry_value_t> Breadcrumbs;
+	};
+	TArray<FPreviousRun> PreviousRuns;
+
+	double LastHeartbeat = 0.0;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "SentryLevelLoadTracker.h"
+#include "SentryClientModule.h"
+
+#include "Engine/Engine.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/PackageName.h"
+#include "UObject/UObjectGlobals.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentryLevelLoadTracker::FSentryLevelLoadTracker()
+{
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &FSentryLevelLoadTracker::OnPreLoadMap);
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FSentryLevelLoadTracker::OnPostLoadMap);
+	SeamlessTravelHandle = FWorldDelegates::OnSeamlessTravelStart.AddRaw(this, &FSentryLevelLoadTracker::OnSeamlessTravelStart);
+	WorldInitHandle = FWorldDelegates::OnPostWorldInitialization.AddRaw(this, &FSentryLevelLoadTracker::OnPostWorldInitialization);
+	ActorsInitHandle = FWorldDelegates::OnWorldInitializedActors.AddRaw(this, &FSentryLevelLoadTracker::OnWorldInitializedActors);
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddRaw(this, &FSentryLevelLoadTracker::OnLevelAddedToWorld);
+	if (GEngine)
+	{
+		TravelFailureHandle = GEngine->OnTravelFailure().AddRaw(this, &FSentryLevelLoadTracker::OnTravelFailure);
+		NetworkFailureHandle = GEngine->OnNetworkFailure().AddRaw(this, &FSentryLevelLoadTracker::OnNetworkFailure);
+	}
+}
+
+FSentryLevelLoadTracker::~FSentryLevelLoadTracker()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	FWorldDelegates::OnSeamlessTravelStart.Remove(SeamlessTravelHandle);
+	FWorldDelegates::OnPostWorldInitialization.Remove(WorldInitHandle);
+	FWorldDelegates::OnWorldInitializedActors.Remove(ActorsInitHandle);
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	if (GEngine)
+	{
+		GEngine->OnTravelFailure().Remove(TravelFailureHandle);
+		GEngine->OnNetworkFailure().Remove(NetworkFailureHandle);
+	}
+	// a load in progress is sent as cancelled
+	Span.SetStatus(ESentrySpanStatus::Cancelled);
+	Transaction.SetStatus(ESentrySpanStatus::Cancelled);
+}
+
+void FSentryLevelLoadTracker::Begin(const FString& InMapName, const TCHAR* Operation, const FString& FirstSpan)
+{
+	// a previous load which never completed
+	if (Transaction.IsValid())
+	{
+		End(ESentrySpanStatus::Aborted);
+	}
+
+	MapName = FPackageName::GetShortName(InMapName);
+	Transaction = FSentryTransaction::Start(FString::Printf(TEXT("%s %s"), Operation, *MapName), Operation);
+	if (!Transaction.IsValid())
+	{
+		return;
+	}
+	Transaction.SetTag(TEXT("map"), MapName);
+	Transaction.SetData(TEXT("map_path"), InMapName);
+	// spans in game code (SENTRY_SPAN) during the load become part of it
+	Transaction.MakeCurrent();
+	StartTime = FPlatformTime::Seconds();
+	StreamedLevels = 0;
+	Span = Transaction.StartChild(FirstSpan, MapName);
+}
+
+void FSentryLevelLoadTracker::NextSpan(const FString& Operation, const FString& Description)
+{
+	if (Transaction.IsValid())
+	{
+		Span.Finish();
+		Span = Transaction.StartChild(Operation, Description);
+	}
+}
+
+void FSentryLevelLoadTracker::End(ESentrySpanStatus Status)
+{
+	if (!Transaction.IsValid())
+	{
+		return;
+	}
+	const double LoadTime = FPlatformTime::Seconds() - StartTime;
+	Span.SetStatus(Status);
+	Span.Finish();
+	Transaction.SetStatus(Status);
+	Transaction.SetData(TEXT("load_time_ms"), LoadTime * 1000.0);
+	Transaction.SetData(TEXT("streamed_levels"), (double)StreamedLevels);
+	Transaction.Finish();
+	UE_LOG(LogSentryClient, Log, TEXT("Map %s loaded in %.1f ms"), *MapName, LoadTime * 1000.0);
+}
+
+void FSentryLevelLoadTracker::OnPreLoadMap(const FString& InMapName)
+{
+	Begin(InMapName, TEXT("level.load"), TEXT("package.load"));
+}
+
+void FSentryLevelLoadTracker::OnSeamlessTravelStart(UWorld* World, const FString& LevelName)
+{
+	Begin(LevelName, TEXT("level.travel"), TEXT("travel"));
+}
+
+void FSentryLevelLoadTracker::OnPostWorldInitialization(UWorld* World, const UWorld::InitializationValues IVS)
+{
+	// the packages of the new world are loaded, its subsystems and level are being set up
+	if (World && World->IsGameWorld())
+	{
+		NextSpan(TEXT("world.init"), MapName);
+	}
+}
+
+void FSentryLevelLoadTracker::OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params)
+{
+	if (Params.World && Params.World->IsGameWorld())
+	{
+		NextSpan(TEXT("begin_play"), MapName);
+	}
+}
+
+void FSentryLevelLoadTracker::OnLevelAddedToWorld(ULevel* Level, UWorld* World)
+{
+	if (Transaction.IsValid())
+	{
+		StreamedLevels++;
+	}
+}
+
+void FSentryLevelLoadTracker::OnPostLoadMap(UWorld* World)
+{
+	End(World ? ESentrySpanStatus::Ok : ESentrySpanStatus::InternalError);
+}
+
+void FSentryLevelLoadTracker::OnTravelFailure(UWorld* World, ETravelFailure::Type FailureType, const FString& Error)
+{
+	if (Transaction.IsValid())
+	{
+		Transaction.SetData(TEXT("failure"), FString(ETravelFailure::ToString(FailureType)));
+		End(ESentrySpanStatus::Aborted);
+	}
+}
+
+void FSentryLevelLoadTracker::OnNetworkFailure(UWorld* World, UNetDriver* NetDriver, ENetworkFailure::Type FailureType, const FString& Error)
+{
+	if (Transaction.IsValid())
+	{
+		Transaction.SetData(TEXT("failure"), FString(ENetworkFailure::ToString(FailureType)));
+		End(ESentrySpanStatus::Unavailable);
+	}
+}
+
+#endif // SENTRY_HAVE_PLATFORM
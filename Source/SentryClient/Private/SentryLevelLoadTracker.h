@@ -0,0 +1,53 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "SentryTracing.h"
+#include "Engine/World.h"
+
+class UNetDriver;
+class ULevel;
+
+#if SENTRY_HAVE_PLATFORM
+
+// Records every map load as a performance transaction, without any game code.
+// A load is split into spans for loading the packages, initializing the world
+// and BeginPlay.  Seamless travel is recorded as a single travel span.
+class FSentryLevelLoadTracker
+{
+public:
+	FSentryLevelLoadTracker();
+	~FSentryLevelLoadTracker();
+
+private:
+	void OnPreLoadMap(const FString& MapName);
+	void OnSeamlessTravelStart(UWorld* World, const FString& LevelName);
+	void OnPostWorldInitialization(UWorld* World, const UWorld::InitializationValues IVS);
+	void OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params);
+	void OnLevelAddedToWorld(ULevel* Level, UWorld* World);
+	void OnPostLoadMap(UWorld* World);
+	void OnTravelFailure(UWorld* World, ETravelFailure::Type FailureType, const FString& Error);
+	void OnNetworkFailure(UWorld* World, UNetDriver* NetDriver, ENetworkFailure::Type FailureType, const FString& Error);
+
+	void Begin(const FString& MapName, const TCHAR* Operation, const FString& FirstSpan);
+	void NextSpan(const FString& Operation, const FString& Description);
+	void End(ESentrySpanStatus Status);
+
+	FSentryTransaction Transaction;
+	FSentrySpan Span;
+	FString MapName;
+	double StartTime = 0.0;
+	int32 StreamedLevels = 0;
+
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+	FDelegateHandle SeamlessTravelHandle;
+	FDelegateHandle WorldInitHandle;
+	FDelegateHandle ActorsInitHandle;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle TravelFailureHandle;
+	FDelegateHandle NetworkFailureHandle;
+};
+
+#endif
@@ -0,0 +1,201 @@
+#include "SentryMemoryTrend.h"
+#include "SentryClientModule.h"
+#include "SentrySizes.h"
+
+#include "HAL/Event.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/RunnableThread.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+// points of the series sent with a report, the ring is downsampled to this
+static const int32 MaxReportPoints = 120;
+
+FSentryMemoryTrend::FSentryMemoryTrend()
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	Interval = FMath::Max(1.0f, USentryClientConfig::GetConfigFloat(TEXT("MEMORY_SAMPLE_INTERVAL"), Config->MemorySampleInterval));
+	Window = FMath::Max(60.0f, USentryClientConfig::GetConfigFloat(TEXT("MEMORY_LEAK_WINDOW"), Config->MemoryLeakWindow));
+	Threshold = USentryClientConfig::GetConfigFloat(TEXT("MEMORY_LEAK_THRESHOLD"), Config->MemoryLeakThreshold);
+
+	Samples.SetNumZeroed(FMath::Clamp((int32)(Window / Interval), 8, 8192));
+}
+
+FSentryMemoryTrend::~FSentryMemoryTrend()
+{
+	Shutdown();
+}
+
+void FSentryMemoryTrend::Start()
+{
+	if (Thread)
+	{
+		return;
+	}
+	bStopping = false;
+	StartTime = FPlatformTime::Seconds();
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("SentryMemoryTrend"), 64 * 1024, TPri_Lowest);
+	UE_LOG(LogSentryClient, Log, TEXT("Memory trend sampling every %.0fs, leak threshold %.0f MB/h over %.0fs"), Interval, Threshold, Window);
+}
+
+void FSentryMemoryTrend::Shutdown()
+{
+	if (!Thread)
+	{
+		return;
+	}
+	// Kill() calls Stop() and waits for Run() to return
+	Thread->Kill(true);
+	delete Thread;
+	Thread = nullptr;
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
+}
+
+uint32 FSentryMemoryTrend::Run()
+{
+	const uint32 IntervalMs = (uint32)(Interval * 1000.0);
+	while (!bStopping)
+	{
+		Sample();
+		WakeEvent->Wait(IntervalMs);
+	}
+	return 0;
+}
+
+void FSentryMemoryTrend::Stop()
+{
+	bStopping = true;
+	WakeEvent->Trigger();
+}
+
+void FSentryMemoryTrend::Sample()
+{
+	// Reading the stats is a system call or two, made here rather than on a game thread.
+	// Recording the sample and updating the slope is constant time.
+	const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+	const double Now = FPlatformTime::Seconds();
+
+	FSample Sample;
+	Sample.Time = (Now - StartTime) / 3600.0;
+	Sample.UsedPhysical = (double)Stats.UsedPhysical / MB;
+	Sample.UsedVirtual = (double)Stats.UsedVirtual / MB;
+	Sample.PeakUsedPhysical = (double)Stats.PeakUsedPhysical / MB;
+	Record(Sample);
+
+	const double Slope = GetSlope();
+	UpdateContext(Sample, Slope);
+
+	if (Count == Samples.Num() && Slope >= Threshold && Now >= NextReportTime)
+	{
+		NextReportTime = Now + Window;
+		ReportLeak(Slope);
+	}
+}
+
+void FSentryMemoryTrend::Record(const FSample& Sample)
+{
+	if (Count == Samples.Num())
+	{
+		const FSample& Oldest = Samples[Next];
+		SumX -= Oldest.Time;
+		SumY -= Oldest.UsedPhysical;
+		SumXY -= Oldest.Time * Oldest.UsedPhysical;
+		SumXX -= Oldest.Time * Oldest.Time;
+	}
+	else
+	{
+		Count++;
+	}
+	Samples[Next] = Sample;
+	SumX += Sample.Time;
+	SumY += Sample.UsedPhysical;
+	SumXY += Sample.Time * Sample.UsedPhysical;
+	SumXX += Sample.Time * Sample.Time;
+
+	Next = (Next + 1) % Samples.Num();
+	if (Next == 0)
+	{
+		// the running sums drift, start over from the ring once per lap
+		RecomputeSums();
+	}
+}
+
+void FSentryMemoryTrend::RecomputeSums()
+{
+	SumX = SumY = SumXY = SumXX = 0.0;
+	for (int32 i = 0; i < Count; i++)
+	{
+		const FSample& Sample = Samples[i];
+		SumX += Sample.Time;
+		SumY += Sample.UsedPhysical;
+		SumXY += Sample.Time * Sample.UsedPhysical;
+		SumXX += Sample.Time * Sample.Time;
+	}
+}
+
+double FSentryMemoryTrend::GetSlope() const
+{
+	// least squares fit, megabytes per hour
+	const double Denominator = Count * SumXX - SumX * SumX;
+	if (Count < 2 || Denominator <= 0.0)
+	{
+		return 0.0;
+	}
+	return (Count * SumXY - SumX * SumY) / Denominator;
+}
+
+void FSentryMemoryTrend::UpdateContext(const FSample& Sample, double Slope)
+{
+	sentry_value_t trend = sentry_value_new_object();
+	sentry_value_set_by_key(trend, "type", sentry_value_new_string("memory_trend"));
+	sentry_value_set_by_key(trend, "used_physical_mb", sentry_value_new_int32((int32_t)Sample.UsedPhysical));
+	sentry_value_set_by_key(trend, "used_virtual_mb", sentry_value_new_int32((int32_t)Sample.UsedVirtual));
+	sentry_value_set_by_key(trend, "peak_used_physical_mb", sentry_value_new_int32((int32_t)Sample.PeakUsedPhysical));
+	sentry_value_set_by_key(trend, "growth_mb_per_hour", sentry_value_new_double(Slope));
+	sentry_value_set_by_key(trend, "window_minutes", sentry_value_new_double((Count - 1) * Interval / 60.0));
+	sentry_set_context("memory_trend", trend);
+}
+
+void FSentryMemoryTrend::ReportLeak(double Slope)
+{
+	UE_LOG(LogSentryClient, Warning, TEXT("Memory growing by %.0f MB/h, reporting"), Slope);
+
+	FString Message = FString::Printf(TEXT("Memory growing by %.0f MB per hour"), Slope);
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_WARNING, "sentry.memory", TCHAR_TO_UTF8(*Message));
+
+	// the ring from oldest to newest, averaged down to at most MaxReportPoints
+	sentry_value_t times = sentry_value_new_list();
+	sentry_value_t used = sentry_value_new_list();
+	const int32 Step = FMath::DivideAndRoundUp(Count, MaxReportPoints);
+	for (int32 i = 0; i < Count; i += Step)
+	{
+		double Time = 0.0, Used = 0.0;
+		const int32 Num = FMath::Min(Step, Count - i);
+		for (int32 j = 0; j < Num; j++)
+		{
+			const FSample& Sample = Samples[(Next + i + j) % Samples.Num()];
+			Time += Sample.Time;
+			Used += Sample.UsedPhysical;
+		}
+		sentry_value_append(times, sentry_value_new_double(FMath::RoundToDouble(Time / Num * 60.0)));
+		sentry_value_append(used, sentry_value_new_int32((int32_t)(Used / Num)));
+	}
+	sentry_value_t extra = sentry_value_new_object();
+	sentry_value_set_by_key(extra, "minutes", times);
+	sentry_value_set_by_key(extra, "used_physical_mb", used);
+	sentry_value_set_by_key(extra, "threshold_mb_per_hour", sentry_value_new_double(Threshold));
+	sentry_value_set_by_key(event, "extra", extra);
+
+	sentry_value_t fingerprint = sentry_value_new_list();
+	sentry_value_append(fingerprint, sentry_value_new_string("memory-leak-trend"));
+	sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+	sentry_capture_event(event);
+}
+
+#endif // SENTRY_HAVE_PLATFORM
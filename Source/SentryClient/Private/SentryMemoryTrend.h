@@ -0,0 +1,73 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+#include <atomic>
+
+#if SENTRY_HAVE_PLATFORM
+
+class FRunnableThread;
+class FEvent;
+
+// Samples the memory use of the process on a background thread into a fixed ring, and
+// keeps a running least squares slope of the used physical memory over it.  When the
+// ring is full and memory grows faster than the threshold, a warning event is sent with
+// the series, once per window.  The latest sample is kept as the memory_trend context
+// of all events.
+class FSentryMemoryTrend : public FRunnable
+{
+public:
+	FSentryMemoryTrend();
+	virtual ~FSentryMemoryTrend();
+
+	void Start();
+	// stop the thread and wait for it to exit
+	void Shutdown();
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	struct FSample
+	{
+		// hours since the sampler started, and megabytes
+		double Time;
+		double UsedPhysical;
+		double UsedVirtual;
+		double PeakUsedPhysical;
+	};
+
+	void Sample();
+	void Record(const FSample& Sample);
+	void RecomputeSums();
+	double GetSlope() const;
+	void UpdateContext(const FSample& Sample, double Slope);
+	void ReportLeak(double Slope);
+
+	// configuration
+	double Interval = 10.0;
+	double Window = 3600.0;
+	double Threshold = 100.0;	// megabytes per hour
+
+	// only touched by the sampler thread
+	TArray<FSample> Samples;
+	int32 Next = 0;
+	int32 Count = 0;
+	// sums for the slope of used physical memory over the ring
+	double SumX = 0.0;
+	double SumY = 0.0;
+	double SumXY = 0.0;
+	double SumXX = 0.0;
+	double StartTime = 0.0;
+	double NextReportTime = 0.0;
+
+	std::atomic<bool> bStopping{ false };
+	FEvent* WakeEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+};
+
+#endif
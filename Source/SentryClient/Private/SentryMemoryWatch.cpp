@@ -0,0 +1,167 @@
+#include "SentryMemoryWatch.h"
+#include "SentryClientModule.h"
+#include "SentrySizes.h"
+
+#include "HAL/LowLevelMemTracker.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/CoreDelegates.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+// seconds between two looks at the memory stats
+static const double PollInterval = 1.0;
+
+// the low memory state is left when the available memory is this many times the threshold
+static const int64 RecoveryFactor = 2;
+
+// number of LLM tags included in a report
+static const int32 MaxLLMTags = 16;
+
+// how long to wait for the out of memory report to be handed to the transport
+static const uint64 OutOfMemoryFlushMs = 2000;
+
+FSentryMemoryWatch::FSentryMemoryWatch()
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	ReserveSize = FMath::Max(0, USentryClientConfig::GetConfigInt(TEXT("EMERGENCY_RESERVE_MB"), Config->EmergencyReserveMB)) * MB;
+	ThresholdBytes = FMath::Max(0, USentryClientConfig::GetConfigInt(TEXT("LOW_MEMORY_THRESHOLD_MB"), Config->LowMemoryThresholdMB)) * MB;
+
+	Reserve();
+	OutOfMemoryHandle = FCoreDelegates::GetOutOfMemoryDelegate().AddRaw(this, &FSentryMemoryWatch::OnOutOfMemory);
+	UE_LOG(LogSentryClient, Log, TEXT("Memory watch started, reserve %lld MB, low memory threshold %lld MB"), ReserveSize / MB, ThresholdBytes / MB);
+}
+
+FSentryMemoryWatch::~FSentryMemoryWatch()
+{
+	FCoreDelegates::GetOutOfMemoryDelegate().Remove(OutOfMemoryHandle);
+	if (!bOutOfMemory)
+	{
+		Release();
+	}
+}
+
+void FSentryMemoryWatch::Reserve()
+{
+	if (ReserveBlock || ReserveSize <= 0)
+	{
+		return;
+	}
+	ReserveBlock = FMemory::Malloc(ReserveSize);
+	// touch every page, so that the memory is committed and not just address space
+	FMemory::Memset(ReserveBlock, 0, ReserveSize);
+}
+
+void FSentryMemoryWatch::Release()
+{
+	if (ReserveBlock)
+	{
+		FMemory::Free(ReserveBlock);
+		ReserveBlock = nullptr;
+	}
+}
+
+void FSentryMemoryWatch::Tick()
+{
+	if (ThresholdBytes <= 0 || bOutOfMemory)
+	{
+		return;
+	}
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastPollTime < PollInterval)
+	{
+		return;
+	}
+	LastPollTime = Now;
+
+	const int64 Available = (int64)FPlatformMemory::GetStats().AvailablePhysical;
+	if (!bLowMemoryReported && Available < ThresholdBytes)
+	{
+		bLowMemoryReported = true;
+		Release();
+
+		FString Message = FString::Printf(TEXT("Low memory: %lld MB of physical memory available"), Available / MB);
+		UE_LOG(LogSentryClient, Warning, TEXT("%s"), *Message);
+		sentry_capture_event(MakeReport("warning", Message));
+	}
+	else if (bLowMemoryReported && Available > ThresholdBytes * RecoveryFactor)
+	{
+		// memory has recovered, arm again
+		bLowMemoryReported = false;
+		Reserve();
+	}
+}
+
+void FSentryMemoryWatch::OnOutOfMemory()
+{
+	// called on the thread where the allocation failed, right before the engine's fatal error
+	if (bOutOfMemory.exchange(true))
+	{
+		return;
+	}
+	Release();
+
+	FString Message = FString::Printf(TEXT("Out of memory allocating %llu bytes"), (uint64)FPlatformMemory::OOMAllocationSize);
+	sentry_value_t event = MakeReport("fatal", Message);
+
+	// The crash report that follows carries the scope, so let it know about the memory state as well
+	sentry_set_tag("out_of_memory", "true");
+	sentry_value_t contexts = sentry_value_get_by_key(event, "contexts");
+	sentry_value_t memory = sentry_value_get_by_key(contexts, "memory");
+	sentry_value_incref(memory);
+	sentry_set_context("memory", memory);
+
+	sentry_capture_event(event);
+	sentry_flush(OutOfMemoryFlushMs);
+}
+
+sentry_value_t FSentryMemoryWatch::MakeReport(const char* Level, const FString& Message)
+{
+	const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_INFO, "sentry.memory", TCHAR_TO_UTF8(*Message));
+	sentry_value_set_by_key(event, "level", sentry_value_new_string(Level));
+
+	sentry_value_t memory = sentry_value_new_object();
+	sentry_value_set_by_key(memory, "type", sentry_value_new_string("memory"));
+	sentry_value_set_by_key(memory, "total_physical_mb", sentry_value_new_int32((int32_t)(Stats.TotalPhysical / MB)));
+	sentry_value_set_by_key(memory, "available_physical_mb", sentry_value_new_int32((int32_t)(Stats.AvailablePhysical / MB)));
+	sentry_value_set_by_key(memory, "used_physical_mb", sentry_value_new_int32((int32_t)(Stats.UsedPhysical / MB)));
+	sentry_value_set_by_key(memory, "peak_used_physical_mb", sentry_value_new_int32((int32_t)(Stats.PeakUsedPhysical / MB)));
+	sentry_value_set_by_key(memory, "available_virtual_mb", sentry_value_new_int32((int32_t)(Stats.AvailableVirtual / MB)));
+	sentry_value_set_by_key(memory, "used_virtual_mb", sentry_value_new_int32((int32_t)(Stats.UsedVirtual / MB)));
+	sentry_value_set_by_key(memory, "reserve_mb", sentry_value_new_int32((int32_t)(ReserveSize / MB)));
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	// the largest LLM tags, if the tracker is running (-LLM)
+	if (FLowLevelMemTracker::Get().IsEnabled())
+	{
+		TArray<TPair<int64, const TCHAR*>, TInlineAllocator<(int32)ELLMTag::GenericTagCount>> Tags;
+		for (int32 Tag = 0; Tag < (int32)ELLMTag::GenericTagCount; Tag++)
+		{
+			const TCHAR* Name = LLMGetTagName((ELLMTag)Tag);
+			const int64 Amount = Name ? FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, (ELLMTag)Tag) : 0;
+			if (Amount > 0)
+			{
+				Tags.Emplace(Amount, Name);
+			}
+		}
+		Tags.Sort([](const TPair<int64, const TCHAR*>& A, const TPair<int64, const TCHAR*>& B) { return A.Key > B.Key; });
+
+		sentry_value_t llm = sentry_value_new_object();
+		for (int32 i = 0; i < FMath::Min(Tags.Num(), MaxLLMTags); i++)
+		{
+			sentry_value_set_by_key(llm, TCHAR_TO_UTF8(Tags[i].Value), sentry_value_new_int32((int32_t)(Tags[i].Key / MB)));
+		}
+		sentry_value_set_by_key(memory, "llm_mb", llm);
+	}
+#endif
+
+	sentry_value_t contexts = sentry_value_new_object();
+	sentry_value_set_by_key(contexts, "memory", memory);
+	sentry_value_set_by_key(event, "contexts", contexts);
+	return event;
+}
+
+#endif // SENTRY_HAVE_PLATFORM
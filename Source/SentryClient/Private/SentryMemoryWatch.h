@@ -0,0 +1,46 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+#if SENTRY_HAVE_PLATFORM
+
+// Reports low memory conditions and out of memory failures.
+// Building and sending an event needs memory, which is exactly what is missing
+// when the process runs out of it.  A block of memory is reserved at startup and
+// released just before the report is built, to give us (and the engine's own
+// fatal error path) some room to work with.
+class FSentryMemoryWatch
+{
+public:
+	FSentryMemoryWatch();
+	~FSentryMemoryWatch();
+
+	// Poll the memory stats.  Call on the game thread.
+	void Tick();
+
+private:
+	void OnOutOfMemory();
+
+	void Reserve();
+	void Release();
+
+	// Build an event with the memory stats and the largest LLM tags
+	sentry_value_t MakeReport(const char* Level, const FString& Message);
+
+	int64 ReserveSize = 0;
+	int64 ThresholdBytes = 0;
+	void* ReserveBlock = nullptr;
+
+	// a low memory condition has been reported, and memory hasn't recovered yet
+	bool bLowMemoryReported = false;
+	double LastPollTime = 0.0;
+
+	std::atomic<bool> bOutOfMemory{ false };
+	FDelegateHandle OutOfMemoryHandle;
+};
+
+#endif
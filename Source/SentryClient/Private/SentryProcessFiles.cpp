@@ -0,0 +1,47 @@
+#include "SentryProcessFiles.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/Paths.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FString FSentryProcessFiles::GetPath(const FString& Directory, const TCHAR* Name, const TCHAR* Extension)
+{
+	return FPaths::Combine(Directory, FString::Printf(TEXT("%s-%u.%s"), Name, FPlatformProcess::GetCurrentProcessId(), Extension));
+}
+
+TArray<FString> FSentryProcessFiles::ClaimOrphans(const FString& Directory, const TCHAR* Name, const TCHAR* Extension)
+{
+	const uint32 OwnId = FPlatformProcess::GetCurrentProcessId();
+	const FString Prefix = FString(Name) + TEXT("-");
+
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *FPaths::Combine(Directory, Prefix + TEXT("*.") + Extension), true, false);
+
+	TArray<FString> Claimed;
+	for (const FString& File : Files)
+	{
+		const FString Id = FPaths::GetBaseFilename(File).RightChop(Prefix.Len());
+		if (Id.IsEmpty() || !Id.IsNumeric())
+		{
+			continue;
+		}
+		const uint32 ProcessId = (uint32)FCString::Strtoui64(*Id, nullptr, 10);
+		if (ProcessId != OwnId && FPlatformProcess::IsApplicationRunning(ProcessId))
+		{
+			continue;
+		}
+		// the claimed name no longer matches the pattern, a rename only succeeds once
+		const FString Path = FPaths::Combine(Directory, File);
+		const FString ClaimedPath = FString::Printf(TEXT("%s.claimed-%u"), *Path, OwnId);
+		if (IFileManager::Get().Move(*ClaimedPath, *Path, false, false, false, true))
+		{
+			Claimed.Add(ClaimedPath);
+		}
+	}
+	return Claimed;
+}
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+// Files in the database folder which belong to one process, named <Name>-<pid>.<Extension>,
+// so that several instances (dedicated servers on one host, clients started from one install)
+// can share the folder without overwriting each other's files.
+class FSentryProcessFiles
+{
+public:
+	// The file of this process
+	static FString GetPath(const FString& Directory, const TCHAR* Name, const TCHAR* Extension);
+
+	// Claim the files left by processes which are no longer running, and return their new paths.
+	// A file named after this process is from an earlier process with the same id.  Each file is
+	// renamed, so that of several processes starting at the same time only one claims it.  The
+	// caller reads and deletes the claimed files.
+	static TArray<FString> ClaimOrphans(const FString& Directory, const TCHAR* Name, const TCHAR* Extension);
+};
+
+#endif
@@ -0,0 +1,433 @@
+#include "SentryProfiler.h"
+#include "SentryClientModule.h"
+#include "SentrySpanRecorder.h"
+
+#include "CoreGlobals.h"
+#include "Hash/CityHash.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformProperties.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/Guid.h"
+#include "Misc/ScopeLock.h"
+
+#if PLATFORM_LINUX
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#endif
+
+
+#if SENTRY_HAVE_PLATFORM
+
+namespace
+{
+	// the profiler the signal handler samples into, one at a time
+	std::atomic<FSentryProfiler*> ActiveProfiler{ nullptr };
+	// handlers between loading ActiveProfiler and being done with it, a profiler is deleted when there are none
+	std::atomic<int32> HandlersRunning{ 0 };
+
+#if PLATFORM_LINUX
+	void HandleProfilerSignal(int Signal, siginfo_t* Info, void* Context)
+	{
+		const int SavedErrno = errno;
+		HandlersRunning.fetch_add(1);
+		if (FSentryProfiler* Profiler = ActiveProfiler.load())
+		{
+			Profiler->TakeSample(Info, Context);
+		}
+		HandlersRunning.fetch_sub(1);
+		errno = SavedErrno;
+	}
+
+	// the program counter and frame pointer of the interrupted code
+	bool GetRegisters(void* Context, uintptr_t& ProgramCounter, uintptr_t& FramePointer)
+	{
+		const ucontext_t* UserContext = (const ucontext_t*)Context;
+#if PLATFORM_CPU_X86_FAMILY
+		ProgramCounter = (uintptr_t)UserContext->uc_mcontext.gregs[REG_RIP];
+		FramePointer = (uintptr_t)UserContext->uc_mcontext.gregs[REG_RBP];
+		return true;
+#elif PLATFORM_CPU_ARM_FAMILY
+		ProgramCounter = (uintptr_t)UserContext->uc_mcontext.pc;
+		FramePointer = (uintptr_t)UserContext->uc_mcontext.regs[29];
+		return true;
+#else
+		return false;
+#endif
+	}
+#endif
+}
+
+FSentryProfiler::FSentryProfiler(float InFrequency, float MaxDuration)
+	: Frequency(FMath::Clamp(InFrequency, 1.0f, 1000.0f))
+{
+#if PLATFORM_LINUX
+	// the timer measures the cpu time of the calling thread, and the frame walk needs its stack bounds
+	if (!IsInGameThread())
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("The profiler must be created on the game thread"));
+		return;
+	}
+	pthread_attr_t Attributes;
+	void* StackAddress = nullptr;
+	size_t StackSize = 0;
+	if (pthread_getattr_np(pthread_self(), &Attributes) != 0)
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("Could not get the stack of the game thread"));
+		return;
+	}
+	pthread_attr_getstack(&Attributes, &StackAddress, &StackSize);
+	pthread_attr_destroy(&Attributes);
+	StackLow = (uintptr_t)StackAddress;
+	StackHigh = StackLow + StackSize;
+
+	FSentryProfiler* Expected = nullptr;
+	if (!ActiveProfiler.compare_exchange_strong(Expected, this))
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("Another profiler is running"));
+		return;
+	}
+
+	// touch the whole ring now, so that the handler doesn't fault pages in
+	Samples.SetNumZeroed(FMath::Clamp((int32)(Frequency * MaxDuration), 16, 100000));
+
+	// The handler stays installed, a signal arriving after the timer is gone finds no profiler
+	struct sigaction Action = {};
+	Action.sa_sigaction = &HandleProfilerSignal;
+	Action.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&Action.sa_mask);
+	if (sigaction(SIGPROF, &Action, nullptr) != 0)
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("Could not install the profiler signal handler, errno %d"), errno);
+		ActiveProfiler = nullptr;
+		return;
+	}
+
+	// The signal goes to the game thread only, and the timer runs on its cpu time, so that
+	// a game thread which is sleeping or waiting is not interrupted
+	ThreadId = GGameThreadId;
+	struct sigevent Event = {};
+	Event.sigev_notify = SIGEV_THREAD_ID;
+	Event.sigev_signo = SIGPROF;
+	Event._sigev_un._tid = (pid_t)ThreadId;
+	timer_t TimerId;
+	if (timer_create(CLOCK_THREAD_CPUTIME_ID, &Event, &TimerId) != 0)
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("Could not create the profiler timer, errno %d"), errno);
+		ActiveProfiler = nullptr;
+		return;
+	}
+	Timer = (void*)TimerId;
+	bAvailable = true;
+	UE_LOG(LogSentryClient, Log, TEXT("Profiling the game thread at %.0f Hz, %d samples kept"), Frequency, Samples.Num());
+#else
+	UE_LOG(LogSentryClient, Warning, TEXT("Profiling is only implemented on Linux"));
+#endif
+}
+
+FSentryProfiler::~FSentryProfiler()
+{
+#if PLATFORM_LINUX
+	if (bAvailable)
+	{
+		// A signal already pending finds no profiler.  A handler which loaded it before runs on
+		// the game thread, so there is one only when deleting it from another thread.
+		timer_delete((timer_t)Timer);
+		ActiveProfiler = nullptr;
+		while (HandlersRunning.load() != 0)
+		{
+			FPlatformProcess::Yield();
+		}
+	}
+#endif
+}
+
+int64 FSentryProfiler::Begin()
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Running++ == 0)
+	{
+		SetTimer(true);
+	}
+	return NextSample.load(std::memory_order_acquire);
+}
+
+int64 FSentryProfiler::End()
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Running > 0 && --Running == 0)
+	{
+		SetTimer(false);
+	}
+	return NextSample.load(std::memory_order_acquire);
+}
+
+void FSentryProfiler::SetTimer(bool bRunning)
+{
+#if PLATFORM_LINUX
+	if (!bAvailable)
+	{
+		return;
+	}
+	const int64 Interval = bRunning ? (int64)(1000000000.0 / Frequency) : 0;
+	struct itimerspec Spec = {};
+	Spec.it_interval.tv_sec = (time_t)(Interval / 1000000000);
+	Spec.it_interval.tv_nsec = (long)(Interval % 1000000000);
+	Spec.it_value = Spec.it_interval;
+	timer_settime((timer_t)Timer, 0, &Spec, nullptr);
+#endif
+}
+
+void FSentryProfiler::TakeSample(void* SignalInfo, void* SignalContext)
+{
+#if PLATFORM_LINUX
+	// single writer: the handler on the game thread, which doesn't interrupt itself
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const int64 Sequence = NextSample.load(std::memory_order_relaxed);
+	FSample& Sample = Samples[Sequence % Samples.Num()];
+	Sample.Time = FPlatformTime::Seconds();
+
+	// Walk the frame pointer chain by hand: the unwinders take locks and are not async signal
+	// safe.  Each frame holds the caller's frame pointer and the return address, and frames
+	// must go up the stack of the game thread.  Code built without frame pointers ends the walk.
+	int32 NumFrames = 0;
+	uintptr_t ProgramCounter = 0;
+	uintptr_t Frame = 0;
+	if (GetRegisters(SignalContext, ProgramCounter, Frame))
+	{
+		Sample.Frames[NumFrames++] = (void*)ProgramCounter;
+		while (NumFrames < MaxFrames && Frame >= StackLow && Frame + 2 * sizeof(uintptr_t) <= StackHigh &&
+			Frame % sizeof(uintptr_t) == 0)
+		{
+			const uintptr_t* Slots = (const uintptr_t*)Frame;
+			const uintptr_t Caller = Slots[0];
+			const uintptr_t ReturnAddress = Slots[1];
+			if (ReturnAddress == 0)
+			{
+				break;
+			}
+			// sentry adjusts return addresses of the caller frames when symbolicating
+			Sample.Frames[NumFrames++] = (void*)ReturnAddress;
+			if (Caller <= Frame)
+			{
+				break;
+			}
+			Frame = Caller;
+		}
+	}
+	Sample.NumFrames = NumFrames;
+
+	NextSample.store(Sequence + 1, std::memory_order_release);
+	SampleCycles.fetch_add(FPlatformTime::Cycles64() - StartCycles, std::memory_order_relaxed);
+#endif
+}
+
+double FSentryProfiler::GetSampleCost() const
+{
+	const int64 Taken = NextSample.load(std::memory_order_relaxed);
+	return Taken ? FPlatformTime::ToSeconds64(SampleCycles.load(std::memory_order_relaxed)) * 1000000.0 / Taken : 0.0;
+}
+
+FSentryProfiler::FSamples FSentryProfiler::CopySamples(int64 First, int64 Last) const
+{
+	FSamples Copied;
+	Copied.ThreadId = ThreadId;
+	const int32 Capacity = Samples.Num();
+	First = FMath::Max(First, Last - Capacity);
+	if (Capacity == 0 || Last <= First)
+	{
+		return Copied;
+	}
+
+	// Copy the samples, then drop those the handler may have overwritten meanwhile
+	Copied.Samples.SetNumUninitialized((int32)(Last - First));
+	for (int64 Sequence = First; Sequence < Last; Sequence++)
+	{
+		Copied.Samples[(int32)(Sequence - First)] = Samples[Sequence % Capacity];
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	const int64 Overwritten = NextSample.load(std::memory_order_relaxed) - Capacity;
+	const int32 Skip = (int32)FMath::Clamp<int64>(Overwritten + 1 - First, 0, Copied.Samples.Num());
+	Copied.Samples.RemoveAt(0, Skip, false);
+	return Copied;
+}
+
+sentry_value_t FSentryProfiler::MakeProfile(const FSamples& Copied, const FSentryTransactionRecord& Transaction,
+	const FString& EventId, const FString& Release, const FString& Environment)
+{
+	const FString ThreadName = FString::Printf(TEXT("%u"), Copied.ThreadId);
+	const FTCHARToUTF8 ThreadIdString(*ThreadName);
+	const double StartTime = Transaction.Spans[0].StartTime;
+	const double EndTime = Transaction.Spans[0].EndTime;
+
+	// frames and stacks are stored once, samples refer to them by index
+	sentry_value_t frames = sentry_value_new_list();
+	sentry_value_t stacks = sentry_value_new_list();
+	sentry_value_t samples = sentry_value_new_list();
+	TMap<void*, int32> FrameIndices;
+	TMap<uint64, int32> StackIndices;
+	int32 NumSamples = 0;
+	for (const FSample& Sample : Copied.Samples)
+	{
+		if (Sample.Time < StartTime || Sample.Time > EndTime || Sample.NumFrames == 0)
+		{
+			continue;
+		}
+
+		// leaf first
+		int32 Stack[MaxFrames];
+		for (int32 Frame = 0; Frame < Sample.NumFrames; Frame++)
+		{
+			int32* Index = FrameIndices.Find(Sample.Frames[Frame]);
+			if (!Index)
+			{
+				Index = &FrameIndices.Add(Sample.Frames[Frame], FrameIndices.Num());
+				sentry_value_t frame = sentry_value_new_object();
+				sentry_value_set_by_key(frame, "instruction_addr",
+					sentry_value_new_string(TCHAR_TO_UTF8(*FString::Printf(TEXT("0x%llx"), (uint64)(UPTRINT)Sample.Frames[Frame]))));
+				sentry_value_append(frames, frame);
+			}
+			Stack[Frame] = *Index;
+		}
+		const uint64 Hash = CityHash64((const char*)Stack, Sample.NumFrames * sizeof(int32));
+		int32* StackIndex = StackIndices.Find(Hash);
+		if (!StackIndex)
+		{
+			StackIndex = &StackIndices.Add(Hash, StackIndices.Num());
+			sentry_value_t stack = sentry_value_new_list();
+			for (int32 Frame = 0; Frame < Sample.NumFrames; Frame++)
+			{
+				sentry_value_append(stack, sentry_value_new_int32(Stack[Frame]));
+			}
+			sentry_value_append(stacks, stack);
+		}
+
+		sentry_value_t sample = sentry_value_new_object();
+		const uint64 Elapsed = (uint64)((Sample.Time - StartTime) * 1000000000.0);
+		sentry_value_set_by_key(sample, "elapsed_since_start_ns", sentry_value_new_string(TCHAR_TO_UTF8(*FString::Printf(TEXT("%llu"), Elapsed))));
+		sentry_value_set_by_key(sample, "thread_id", sentry_value_new_string((const ANSICHAR*)ThreadIdString.Get()));
+		sentry_value_set_by_key(sample, "stack_id", sentry_value_new_int32(*StackIndex));
+		sentry_value_append(samples, sample);
+		NumSamples++;
+	}
+	if (NumSamples == 0)
+	{
+		sentry_value_decref(frames);
+		sentry_value_decref(stacks);
+		sentry_value_decref(samples);
+		return sentry_value_new_null();
+	}
+
+	sentry_value_t thread = sentry_value_new_object();
+	sentry_value_set_by_key(thread, "name", sentry_value_new_string("GameThread"));
+	sentry_value_t threads = sentry_value_new_object();
+	sentry_value_set_by_key(threads, (const ANSICHAR*)ThreadIdString.Get(), thread);
+
+	sentry_value_t data = sentry_value_new_object();
+	sentry_value_set_by_key(data, "samples", samples);
+	sentry_value_set_by_key(data, "stacks", stacks);
+	sentry_value_set_by_key(data, "frames", frames);
+	sentry_value_set_by_key(data, "thread_metadata", threads);
+
+	sentry_value_t profile = sentry_value_new_object();
+	sentry_value_set_by_key(profile, "event_id", sentry_value_new_string(TCHAR_TO_UTF8(*FGuid::NewGuid().ToString(EGuidFormats::Digits).ToLower())));
+	sentry_value_set_by_key(profile, "version", sentry_value_new_string("1"));
+	sentry_value_set_by_key(profile, "platform", sentry_value_new_string("native"));
+	const FDateTime Timestamp = FDateTime(1970, 1, 1) + FTimespan::FromSeconds(Transaction.StartUnixTime);
+	sentry_value_set_by_key(profile, "timestamp", sentry_value_new_string(TCHAR_TO_UTF8(*Timestamp.ToIso8601())));
+	if (!Release.IsEmpty())
+	{
+		sentry_value_set_by_key(profile, "release", sentry_value_new_string(TCHAR_TO_UTF8(*Release)));
+	}
+	if (!Environment.IsEmpty())
+	{
+		sentry_value_set_by_key(profile, "environment", sentry_value_new_string(TCHAR_TO_UTF8(*Environment)));
+	}
+
+	sentry_value_t os = sentry_value_new_object();
+	sentry_value_set_by_key(os, "name", sentry_value_new_string(FPlatformProperties::IniPlatformName()));
+	sentry_value_set_by_key(os, "version", sentry_value_new_string(TCHAR_TO_UTF8(*FPlatformMisc::GetOSVersion())));
+	sentry_value_set_by_key(profile, "os", os);
+	sentry_value_t device = sentry_value_new_object();
+	sentry_value_set_by_key(device, "architecture", sentry_value_new_string(PLATFORM_CPU_ARM_FAMILY ? "arm64" : "x86_64"));
+	sentry_value_set_by_key(profile, "device", device);
+
+	// the images, for symbolication of the addresses
+	sentry_value_t debug_meta = sentry_value_new_object();
+	sentry_value_set_by_key(debug_meta, "images", sentry_get_modules_list());
+	sentry_value_set_by_key(profile, "debug_meta", debug_meta);
+
+	sentry_value_t transaction = sentry_value_new_object();
+	sentry_value_set_by_key(transaction, "id", sentry_value_new_string(TCHAR_TO_UTF8(*EventId)));
+	sentry_value_set_by_key(transaction, "name", sentry_value_new_string(Transaction.GetText(Transaction.Name)));
+	sentry_value_set_by_key(transaction, "trace_id", sentry_value_new_string(TCHAR_TO_UTF8(*Transaction.TraceId.ToString(EGuidFormats::Digits).ToLower())));
+	sentry_value_set_by_key(transaction, "active_thread_id", sentry_value_new_string((const ANSICHAR*)ThreadIdString.Get()));
+	sentry_value_set_by_key(profile, "transaction", transaction);
+
+	sentry_value_set_by_key(profile, "profile", data);
+	return profile;
+}
+
+
+#if !UE_BUILD_SHIPPING && PLATFORM_LINUX
+
+// Sentry.BenchmarkProfiler: the overhead of profiling the game thread at several frequencies
+static FAutoConsoleCommand BenchmarkProfilerCommand(
+	TEXT("Sentry.BenchmarkProfiler"),
+	TEXT("Measure the overhead of the sampling profiler on the game thread at 50, 100, 250 and 1000 Hz."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		if (ActiveProfiler.load() != nullptr)
+		{
+			UE_LOG(LogSentryClient, Display, TEXT("The profiler is running, set ProfilesSampleRate to 0 to benchmark it"));
+			return;
+		}
+
+		// a fixed amount of work, about a quarter of a second of it
+		auto Work = [](int64 Iterations)
+		{
+			uint8 Buffer[256] = {};
+			uint64 Hash = 0;
+			const double Start = FPlatformTime::Seconds();
+			for (int64 i = 0; i < Iterations; i++)
+			{
+				Buffer[i & 255] ^= (uint8)Hash;
+				Hash ^= CityHash64((const char*)Buffer, sizeof(Buffer));
+			}
+			volatile uint64 Sink = Hash;
+			(void)Sink;
+			return FPlatformTime::Seconds() - Start;
+		};
+		const int64 Iterations = (int64)(100000 * 0.25 / FMath::Max(Work(100000), 1e-6));
+
+		const float Frequencies[] = { 50.0f, 100.0f, 250.0f, 1000.0f };
+		for (float Frequency : Frequencies)
+		{
+			const double Baseline = FMath::Min(Work(Iterations), Work(Iterations));
+			double Profiled;
+			int64 Taken;
+			double SampleCost;
+			{
+				FSentryProfiler Profiler(Frequency, 1.0f);
+				if (!Profiler.IsAvailable())
+				{
+					return;
+				}
+				const int64 First = Profiler.Begin();
+				Profiled = Work(Iterations);
+				Taken = Profiler.End() - First;
+				SampleCost = Profiler.GetSampleCost();
+			}
+			UE_LOG(LogSentryClient, Display, TEXT("%4.0f Hz: %lld samples, %.1f us per sample, overhead %.2f%% (%.1f ms profiled, %.1f ms not)"),
+				Frequency, Taken, SampleCost, (Profiled - Baseline) * 100.0 / Baseline, Profiled * 1000.0, Baseline * 1000.0);
+		}
+	}));
+
+#endif
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+#include <atomic>
+
+#if SENTRY_HAVE_PLATFORM
+
+struct FSentryTransactionRecord;
+
+// A sampling profiler of the game thread, for transactions recorded by FSentrySpanRecorder.
+// While a profiled transaction runs, a timer on the cpu time of the game thread signals it at
+// the configured frequency, and the handler walks its frame pointers into a preallocated ring.
+// Taking a sample doesn't allocate, lock or call into an unwinder.  Stacks through code built
+// without frame pointers end early.  Create it on the game thread.  When a profiled transaction is sent, the samples taken
+// during it are copied out, and encoded as a profile, see https://develop.sentry.dev/sdk/profiles/
+// Only implemented on Linux, elsewhere IsAvailable() is false.
+class FSentryProfiler
+{
+public:
+	// MaxDuration: seconds of samples in the ring, a longer transaction has the end of its profile
+	FSentryProfiler(float InFrequency, float MaxDuration);
+	// Deletes the timer, and waits for a sample being taken on another thread
+	~FSentryProfiler();
+
+	bool IsAvailable() const { return bAvailable; }
+
+	// Sample while a profiled transaction runs, returns the sequence number of the next sample.  Thread safe.
+	int64 Begin();
+	// The transaction is done, returns the sequence number of the next sample.  Thread safe.
+	int64 End();
+
+	static constexpr int32 MaxFrames = 48;
+
+	struct FSample
+	{
+		// FPlatformTime::Seconds()
+		double Time;
+		int32 NumFrames;
+		void* Frames[MaxFrames];
+	};
+
+	// Samples copied out of the ring, which don't refer to the profiler
+	struct FSamples
+	{
+		uint32 ThreadId = 0;
+		TArray<FSample> Samples;
+	};
+
+	// A copy of the samples [First, Last) which the handler hasn't overwritten.  Thread safe.
+	FSamples CopySamples(int64 First, int64 Last) const;
+
+	// The samples taken during the transaction as its profile, a null value if there are none.
+	// EventId is the id of the transaction event.
+	static sentry_value_t MakeProfile(const FSamples& Copied, const FSentryTransactionRecord& Transaction,
+		const FString& EventId, const FString& Release, const FString& Environment);
+
+	// Called by the signal handler on the game thread
+	void TakeSample(void* SignalInfo, void* SignalContext);
+
+	// average time spent taking a sample so far, in microseconds
+	double GetSampleCost() const;
+
+private:
+	void SetTimer(bool bRunning);
+
+	float Frequency = 100.0f;
+	bool bAvailable = false;
+	uint32 ThreadId = 0;
+	// the stack of the game thread, frames outside of it end a walk
+	uintptr_t StackLow = 0;
+	uintptr_t StackHigh = 0;
+
+	// written by the signal handler only, NextSample is the sequence number of the next one
+	TArray<FSample> Samples;
+	std::atomic<int64> NextSample{ 0 };
+	std::atomic<uint64> SampleCycles{ 0 };
+
+	// profiled transactions running, the timer runs while there are any
+	FCriticalSection Lock;
+	int32 Running = 0;
+	void* Timer = nullptr;
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "SentryServerHealth.h"
+#include "SentryClientModule.h"
+
+#include "Engine/Engine.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "UObject/UObjectGlobals.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentryServerHealth::FSentryServerHealth()
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	Interval = FMath::Max(10.0f, USentryClientConfig::GetConfigFloat(TEXT("SERVER_HEALTH_INTERVAL"), Config->ServerHealthInterval));
+	ConfiguredTargetRate = USentryClientConfig::GetConfigFloat(TEXT("SERVER_TARGET_TICK_RATE"), Config->ServerTargetTickRate);
+	DegradedFraction = FMath::Clamp(USentryClientConfig::GetConfigFloat(TEXT("SERVER_DEGRADED_PERCENT"), Config->ServerDegradedPercent), 1.0f, 100.0f) / 100.0;
+	DegradedSeconds = FMath::Max(1.0f, USentryClientConfig::GetConfigFloat(TEXT("SERVER_DEGRADED_SECONDS"), Config->ServerDegradedSeconds));
+
+	// the tick spanning a blocking map load is not a long tick.  The target rate is known once
+	// the world and its net driver exist.
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &FSentryServerHealth::OnPreLoadMap);
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FSentryServerHealth::OnPostLoadMap);
+	UpdateTargetRate();
+	IntervalStart = SecondStart = FPlatformTime::Seconds();
+}
+
+FSentryServerHealth::~FSentryServerHealth()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+}
+
+void FSentryServerHealth::OnPreLoadMap(const FString& MapName)
+{
+	LastTickCycles = 0;
+	LastTickMicros = 0;
+	DegradedStart = 0.0;
+	// nor is the second spanning it degraded
+	SecondTicks = 0;
+	SecondStart = FPlatformTime::Seconds();
+}
+
+void FSentryServerHealth::OnPostLoadMap(UWorld* World)
+{
+	UpdateTargetRate();
+	SecondTicks = 0;
+	SecondStart = FPlatformTime::Seconds();
+}
+
+void FSentryServerHealth::UpdateTargetRate()
+{
+	// the engine's rate is NetServerMaxTickRate on a dedicated server, it can change with the net driver
+	TargetRate = ConfiguredTargetRate;
+	if (TargetRate <= 0.0f && GEngine)
+	{
+		TargetRate = GEngine->GetMaxTickRate(0.0f, false);
+	}
+	if (TargetRate <= 0.0f)
+	{
+		TargetRate = 30.0f;
+	}
+	LongTickThreshold = (uint64)(2000000.0f / TargetRate);
+}
+
+void FSentryServerHealth::Tick()
+{
+	const uint64 Now = FPlatformTime::Cycles64();
+	if (LastTickCycles != 0)
+	{
+		const uint64 Micros = (uint64)(FPlatformTime::ToSeconds64(Now - LastTickCycles) * 1000000.0);
+		TickTimes.Record(Micros);
+		if (Micros >= LongTickThreshold)
+		{
+			LongTicks++;
+		}
+		if (LastTickMicros != 0)
+		{
+			JitterSum += Micros > LastTickMicros ? Micros - LastTickMicros : LastTickMicros - Micros;
+		}
+		LastTickMicros = Micros;
+		SecondTicks++;
+	}
+	LastTickCycles = Now;
+
+	// the rate over each second, and how long it has been degraded
+	const double Seconds = FPlatformTime::Seconds();
+	if (Seconds - SecondStart >= 1.0)
+	{
+		const double Rate = SecondTicks / (Seconds - SecondStart);
+		if (Rate >= TargetRate * DegradedFraction)
+		{
+			DegradedStart = 0.0;
+			bDegradedReported = false;
+		}
+		else if (DegradedStart == 0.0)
+		{
+			DegradedStart = SecondStart;
+		}
+		else if (!bDegradedReported && Seconds - DegradedStart >= DegradedSeconds)
+		{
+			bDegradedReported = true;
+			ReportDegraded(Rate);
+		}
+		SecondTicks = 0;
+		SecondStart = Seconds;
+	}
+
+	const double Elapsed = Seconds - IntervalStart;
+	if (Elapsed >= Interval)
+	{
+		Report(Elapsed);
+		TickTimes.Reset();
+		LongTicks = 0;
+		JitterSum = 0;
+		UpdateTargetRate();
+		IntervalStart = FPlatformTime::Seconds();
+	}
+}
+
+void FSentryServerHealth::SetServerFields(sentry_value_t Value)
+{
+	if (!GEngine)
+	{
+		return;
+	}
+	for (const FWorldContext& Context : GEngine->GetWorldContexts())
+	{
+		UWorld* World = Context.World();
+		if (World && World->IsGameWorld())
+		{
+			UNetDriver* NetDriver = World->GetNetDriver();
+			sentry_value_set_by_key(Value, "clients", sentry_value_new_int32(NetDriver ? NetDriver->ClientConnections.Num() : 0));
+			sentry_value_set_by_key(Value, "map", sentry_value_new_string(TCHAR_TO_UTF8(*World->GetMapName())));
+			return;
+		}
+	}
+}
+
+void FSentryServerHealth::Report(double Elapsed)
+{
+	if (TickTimes.GetCount() == 0)
+	{
+		return;
+	}
+
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_INFO, "sentry.server", "Server tick report");
+
+	const double Rate = TickTimes.GetCount() / Elapsed;
+	sentry_value_t stats = sentry_value_new_object();
+	sentry_value_set_by_key(stats, "type", sentry_value_new_string("server_tick"));
+	sentry_value_set_by_key(stats, "ticks", sentry_value_new_int32((int32_t)TickTimes.GetCount()));
+	sentry_value_set_by_key(stats, "seconds", sentry_value_new_double(Elapsed));
+	sentry_value_set_by_key(stats, "tick_rate", sentry_value_new_double(Rate));
+	sentry_value_set_by_key(stats, "target_tick_rate", sentry_value_new_double(TargetRate));
+	sentry_value_set_by_key(stats, "target_percent", sentry_value_new_double(Rate * 100.0 / TargetRate));
+	sentry_value_set_by_key(stats, "mean_ms", sentry_value_new_double(TickTimes.GetMean() / 1000.0));
+	sentry_value_set_by_key(stats, "p50_ms", sentry_value_new_double(TickTimes.GetPercentile(0.50) / 1000.0));
+	sentry_value_set_by_key(stats, "p95_ms", sentry_value_new_double(TickTimes.GetPercentile(0.95) / 1000.0));
+	sentry_value_set_by_key(stats, "p99_ms", sentry_value_new_double(TickTimes.GetPercentile(0.99) / 1000.0));
+	sentry_value_set_by_key(stats, "max_ms", sentry_value_new_double(TickTimes.GetMax() / 1000.0));
+	sentry_value_set_by_key(stats, "long_ticks", sentry_value_new_int32((int32_t)LongTicks));
+	sentry_value_set_by_key(stats, "long_tick_ms", sentry_value_new_double(LongTickThreshold / 1000.0));
+	// mean difference between consecutive tick times
+	const uint64 Pairs = TickTimes.GetCount() > 1 ? TickTimes.GetCount() - 1 : 1;
+	sentry_value_set_by_key(stats, "jitter_ms", sentry_value_new_double((double)JitterSum / Pairs / 1000.0));
+	SetServerFields(stats);
+
+	sentry_value_t contexts = sentry_value_new_object();
+	sentry_value_set_by_key(contexts, "server_tick", stats);
+	sentry_value_set_by_key(event, "contexts", contexts);
+
+	sentry_value_t fingerprint = sentry_value_new_list();
+	sentry_value_append(fingerprint, sentry_value_new_string("server-tick-report"));
+	sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+	sentry_capture_event(event);
+}
+
+void FSentryServerHealth::ReportDegraded(double Rate)
+{
+	UE_LOG(LogSentryClient, Warning, TEXT("Server ticking at %.1f Hz, below %.0f%% of %.1f Hz for %.0fs, reporting"),
+		Rate, DegradedFraction * 100.0, TargetRate, DegradedSeconds);
+
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_WARNING, "sentry.server", "Server tick rate degraded");
+
+	sentry_value_t stats = sentry_value_new_object();
+	sentry_value_set_by_key(stats, "type", sentry_value_new_string("server_tick"));
+	sentry_value_set_by_key(stats, "tick_rate", sentry_value_new_double(Rate));
+	sentry_value_set_by_key(stats, "target_tick_rate", sentry_value_new_double(TargetRate));
+	sentry_value_set_by_key(stats, "degraded_percent", sentry_value_new_double(DegradedFraction * 100.0));
+	sentry_value_set_by_key(stats, "degraded_seconds", sentry_value_new_double(DegradedSeconds));
+	SetServerFields(stats);
+
+	sentry_value_t contexts = sentry_value_new_object();
+	sentry_value_set_by_key(contexts, "server_tick", stats);
+	sentry_value_set_by_key(event, "contexts", contexts);
+
+	sentry_value_t fingerprint = sentry_value_new_list();
+	sentry_value_append(fingerprint, sentry_value_new_string("server-tick-degraded"));
+	sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+	sentry_capture_event(event);
+}
+
+#endif // SENTRY_HAVE_PLATFORM
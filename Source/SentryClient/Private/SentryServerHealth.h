@@ -0,0 +1,64 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "SentryHistogram.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+// Tick health of a dedicated server.  Tick times are collected in a histogram and
+// periodically sent as a "Server tick report" with the tick rate against the target
+// rate, percentiles, long ticks and jitter.  When the tick rate stays below a fraction
+// of the target for a while, a "Server tick rate degraded" warning is sent, once until
+// it recovers.
+class FSentryServerHealth
+{
+public:
+	FSentryServerHealth();
+	~FSentryServerHealth();
+
+	// Call on the game thread, once per frame
+	void Tick();
+
+private:
+	void OnPreLoadMap(const FString& MapName);
+	void OnPostLoadMap(UWorld* World);
+	void UpdateTargetRate();
+	void Report(double Elapsed);
+	void ReportDegraded(double Rate);
+
+	// sets the clients and map of the server's world on a context
+	static void SetServerFields(sentry_value_t Value);
+
+	// configuration
+	double Interval = 300.0;
+	float ConfiguredTargetRate = 0.0f;
+	double DegradedFraction = 0.8;
+	double DegradedSeconds = 10.0;
+
+	// ticks per second the server aims for, and a tick longer than twice its period is long
+	float TargetRate = 30.0f;
+	uint64 LongTickThreshold = 66666;	// microseconds
+
+	// tick times in microseconds
+	FSentryHistogram TickTimes;
+	uint32 LongTicks = 0;
+	// sum of the differences between consecutive tick times, for the jitter
+	uint64 JitterSum = 0;
+	uint64 LastTickMicros = 0;
+
+	uint64 LastTickCycles = 0;
+	double IntervalStart = 0.0;
+
+	// ticks in the current second, and how long the rate has been below the threshold
+	uint32 SecondTicks = 0;
+	double SecondStart = 0.0;
+	double DegradedStart = 0.0;
+	bool bDegradedReported = false;
+
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include "SentrySessionAggregator.h"
+#include "SentryClientModule.h"
+#include "SentryProcessFiles.h"
+#include "SentryTransport.h"
+
+#include "GameFramework/GameModeBase.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentrySessionAggregator* FSentrySessionAggregator::Active = nullptr;
+FCriticalSection FSentrySessionAggregator::Lock;
+
+static int64 CurrentMinute()
+{
+	return FDateTime::UtcNow().ToUnixTimestamp() / 60;
+}
+
+FSentrySessionAggregator::FSentrySessionAggregator(TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> InTransport, const FString& DatabasePath,
+	const FString& InRelease, const FString& InEnvironment, bool bInConsentRequired, bool bCrashedLastRun)
+	: Transport(InTransport)
+	, StateFile(FSentryProcessFiles::GetPath(DatabasePath, TEXT("sessions"), TEXT("txt")))
+	, Release(InRelease)
+	, Environment(InEnvironment)
+	, bConsentRequired(bInConsentRequired)
+{
+	if (Release.IsEmpty())
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("Session aggregates need a Release, sessions will be dropped by sentry"));
+	}
+
+	RecoverState(DatabasePath, bCrashedLastRun);
+	{
+		FScopeLock ScopeLock(&Lock);
+		Active = this;
+	}
+
+	PostLoginHandle = FGameModeEvents::GameModePostLoginEvent.AddRaw(this, &FSentrySessionAggregator::OnPostLogin);
+	LogoutHandle = FGameModeEvents::GameModeLogoutEvent.AddRaw(this, &FSentrySessionAggregator::OnLogout);
+
+	// send what was recovered from the previous run right away
+	Flush();
+}
+
+FSentrySessionAggregator::~FSentrySessionAggregator()
+{
+	FGameModeEvents::GameModePostLoginEvent.Remove(PostLoginHandle);
+	FGameModeEvents::GameModeLogoutEvent.Remove(LogoutHandle);
+
+	// an orderly shutdown ends the sessions still open
+	{
+		FScopeLock ScopeLock(&Lock);
+		Active = nullptr;
+		for (const auto& Elem : Sessions)
+		{
+			FBucket& Bucket = Buckets.FindOrAdd(Elem.Value.StartMinute);
+			(Elem.Value.bErrored ? Bucket.Errored : Bucket.Exited)++;
+		}
+		Sessions.Empty();
+	}
+	Flush();
+	SaveState();
+}
+
+void FSentrySessionAggregator::OnErrorEvent()
+{
+	FScopeLock ScopeLock(&Lock);
+	if (Active)
+	{
+		for (auto& Elem : Active->Sessions)
+		{
+			Elem.Value.bErrored = true;
+		}
+	}
+}
+
+void FSentrySessionAggregator::OnPostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer)
+{
+	FScopeLock ScopeLock(&Lock);
+	Sessions.Add(NewPlayer, FSession{ CurrentMinute(), false });
+	bStateChanged = true;
+}
+
+void FSentrySessionAggregator::OnLogout(AGameModeBase* GameMode, AController* Exiting)
+{
+	FScopeLock ScopeLock(&Lock);
+	FSession Session;
+	if (Sessions.RemoveAndCopyValue(Exiting, Session))
+	{
+		FBucket& Bucket = Buckets.FindOrAdd(Session.StartMinute);
+		(Session.bErrored ? Bucket.Errored : Bucket.Exited)++;
+		bStateChanged = true;
+	}
+}
+
+void FSentrySessionAggregator::Tick()
+{
+	const double Now = FPlatformTime::Seconds();
+	if (bStateChanged && Now - LastSave >= SaveInterval)
+	{
+		SaveState();
+		LastSave = Now;
+	}
+	if (Now - LastFlush >= FlushInterval)
+	{
+		Flush();
+	}
+}
+
+void FSentrySessionAggregator::RecoverState(const FString& DatabasePath, bool bCrashedLastRun)
+{
+	// the files of instances which are still running are left alone
+	const TArray<FString> Orphans = FSentryProcessFiles::ClaimOrphans(DatabasePath, TEXT("sessions"), TEXT("txt"));
+
+	// sentry only knows that a run using the folder crashed, not which one: the last one written to
+	FString Latest;
+	FDateTime LatestTime = FDateTime::MinValue();
+	for (const FString& Orphan : Orphans)
+	{
+		const FDateTime Time = IFileManager::Get().GetTimeStamp(*Orphan);
+		if (Time > LatestTime)
+		{
+			Latest = Orphan;
+			LatestTime = Time;
+		}
+	}
+
+	for (const FString& Orphan : Orphans)
+	{
+		const bool bCrashed = bCrashedLastRun && Orphan == Latest;
+		const int32 Count = RecoverFile(Orphan, bCrashed);
+		if (Count > 0)
+		{
+			UE_LOG(LogSentryClient, Log, TEXT("%d sessions of a previous run did not end, counted as %s"),
+				Count, bCrashed ? TEXT("crashed") : TEXT("abnormal"));
+		}
+		IFileManager::Get().Delete(*Orphan, false, false, true);
+	}
+}
+
+int32 FSentrySessionAggregator::RecoverFile(const FString& Filename, bool bCrashed)
+{
+	// one line per session which was open, with the minute it started
+	FString Contents;
+	if (!FFileHelper::LoadFileToString(Contents, *Filename))
+	{
+		return 0;
+	}
+	TArray<FString> Lines;
+	Contents.ParseIntoArrayLines(Lines);
+	int32 Count = 0;
+	for (const FString& Line : Lines)
+	{
+		const int64 StartMinute = FCString::Atoi64(*Line);
+		if (StartMinute > 0)
+		{
+			FBucket& Bucket = Buckets.FindOrAdd(StartMinute);
+			(bCrashed ? Bucket.Crashed : Bucket.Abnormal)++;
+			Count++;
+		}
+	}
+	return Count;
+}
+
+void FSentrySessionAggregator::SaveState()
+{
+	FString Contents;
+	{
+		FScopeLock ScopeLock(&Lock);
+		for (const auto& Elem : Sessions)
+		{
+			Contents += FString::Printf(TEXT("%lld\n"), Elem.Value.StartMinute);
+		}
+		bStateChanged = false;
+	}
+	if (Contents.IsEmpty())
+	{
+		IFileManager::Get().Delete(*StateFile, false, false, true);
+	}
+	else
+	{
+		FFileHelper::SaveStringToFile(Contents, *StateFile);
+	}
+}
+
+void FSentrySessionAggregator::Flush()
+{
+	LastFlush = FPlatformTime::Seconds();
+	TMap<int64, FBucket> Flushed;
+	{
+		FScopeLock ScopeLock(&Lock);
+		Flushed = MoveTemp(Buckets);
+		Buckets.Reset();
+	}
+	if (Flushed.Num() == 0)
+	{
+		return;
+	}
+	// sentry drops everything when consent is required and not given
+	if (bConsentRequired && sentry_user_consent_get() != SENTRY_USER_CONSENT_GIVEN)
+	{
+		return;
+	}
+
+	sentry_value_t aggregates = sentry_value_new_list();
+	for (const auto& Elem : Flushed)
+	{
+		const FBucket& Bucket = Elem.Value;
+		sentry_value_t aggregate = sentry_value_new_object();
+		sentry_value_set_by_key(aggregate, "started", sentry_value_new_string(TCHAR_TO_UTF8(*FDateTime::FromUnixTimestamp(Elem.Key * 60).ToIso8601())));
+		if (Bucket.Exited)
+		{
+			sentry_value_set_by_key(aggregate, "exited", sentry_value_new_int32((int32_t)Bucket.Exited));
+		}
+		if (Bucket.Errored)
+		{
+			sentry_value_set_by_key(aggregate, "errored", sentry_value_new_int32((int32_t)Bucket.Errored));
+		}
+		if (Bucket.Abnormal)
+		{
+			sentry_value_set_by_key(aggregate, "abnormal", sentry_value_new_int32((int32_t)Bucket.Abnormal));
+		}
+		if (Bucket.Crashed)
+		{
+			sentry_value_set_by_key(aggregate, "crashed", sentry_value_new_int32((int32_t)Bucket.Crashed));
+		}
+		sentry_value_append(aggregates, aggregate);
+	}
+
+	sentry_value_t attrs = sentry_value_new_object();
+	sentry_value_set_by_key(attrs, "release", sentry_value_new_string(TCHAR_TO_UTF8(*Release)));
+	if (!Environment.IsEmpty())
+	{
+		sentry_value_set_by_key(attrs, "environment", sentry_value_new_string(TCHAR_TO_UTF8(*Environment)));
+	}
+
+	sentry_value_t payload = sentry_value_new_object();
+	sentry_value_set_by_key(payload, "aggregates", aggregates);
+	sentry_value_set_by_key(payload, "attrs", attrs);
+
+	TArray<FSentryEnvelopeItem> Items;
+	Items.Add(FSentryEnvelopeItem::FromValue(TEXT("sessions"), payload));
+	Transport->SendEnvelope(FString(), MoveTemp(Items));
+}
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+class FSentryTransport;
+class AGameModeBase;
+class APlayerController;
+class AController;
+
+// Release health for dedicated servers.  Each player connected to the server is a session.
+// Rather than sending every session, their outcomes are counted in buckets by the minute
+// the session started, and sent as one sessions aggregate envelope per minute.
+// See https://develop.sentry.dev/sdk/sessions/#session-aggregates-payload
+// The sessions open at any time are kept in a file per process in the database folder, so
+// that after a crash they are counted as crashed on the next run, or as abnormal if it was
+// killed.  Only the files of processes which are gone are recovered.
+class FSentrySessionAggregator
+{
+public:
+	FSentrySessionAggregator(TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> InTransport, const FString& DatabasePath,
+		const FString& InRelease, const FString& InEnvironment, bool bInConsentRequired, bool bCrashedLastRun);
+	~FSentrySessionAggregator();
+
+	// An error event was captured, the open sessions become errored.  Thread safe.
+	static void OnErrorEvent();
+
+	// Call on the game thread, once per frame
+	void Tick();
+
+private:
+	struct FBucket
+	{
+		uint32 Exited = 0;
+		uint32 Errored = 0;
+		uint32 Abnormal = 0;
+		uint32 Crashed = 0;
+	};
+
+	struct FSession
+	{
+		// unix time in minutes
+		int64 StartMinute;
+		bool bErrored;
+	};
+
+	static constexpr double FlushInterval = 60.0;
+	static constexpr double SaveInterval = 1.0;
+
+	void OnPostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer);
+	void OnLogout(AGameModeBase* GameMode, AController* Exiting);
+
+	void RecoverState(const FString& DatabasePath, bool bCrashedLastRun);
+	// counts the sessions left open in a file of a previous run, returns their number
+	int32 RecoverFile(const FString& Filename, bool bCrashed);
+	void SaveState();
+	void Flush();
+
+	// the aggregator which is running, protected by Lock along with the sessions and buckets
+	static FSentrySessionAggregator* Active;
+	static FCriticalSection Lock;
+	TMap<const void*, FSession> Sessions;
+	TMap<int64, FBucket> Buckets;
+	bool bStateChanged = false;
+
+	TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> Transport;
+	FString StateFile;
+	FString Release;
+	FString Environment;
+	bool bConsentRequired = false;
+
+	double LastFlush = 0.0;
+	double LastSave = 0.0;
+
+	FDelegateHandle PostLoginHandle;
+	FDelegateHandle LogoutHandle;
+};
+
+#endif
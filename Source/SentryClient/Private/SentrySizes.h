@@ -0,0 +1,6 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Defined once here, so that the files using it can share a unity build
+static constexpr int64 MB = 1024 * 1024;
@@ -0,0 +1,541 @@
+#include "SentrySpanRecorder.h"
+#include "SentryClientModule.h"
+#include "SentryProfiler.h"
+#include "SentryTailSampler.h"
+#include "SentryTraceSnapshot.h"
+#include "SentryTransport.h"
+
+#include "Async/Async.h"
+#include "GenericPlatform/GenericPlatformHttp.h"
+#include "Hash/CityHash.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
+#include "Misc/ScopeLock.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentrySpanRecorder* FSentrySpanRecorder::Active = nullptr;
+FCriticalSection FSentrySpanRecorder::Lock;
+
+namespace
+{
+	// indexed by ESentrySpanStatus
+	const char* StatusNames[] =
+	{
+		"ok", "cancelled", "unknown", "invalid_argument", "deadline_exceeded", "not_found",
+		"already_exists", "permission_denied", "resource_exhausted", "failed_precondition",
+		"aborted", "out_of_range", "unimplemented", "internal_error", "unavailable",
+		"data_loss", "unauthenticated",
+	};
+
+	sentry_value_t NewString(const FString& Value)
+	{
+		return sentry_value_new_string(TCHAR_TO_UTF8(*Value));
+	}
+
+	// the fields which spans and the trace context have in common
+	void SetSpanFields(sentry_value_t Value, const FSentryTransactionRecord& Transaction, int32 Index, const ANSICHAR* TraceId)
+	{
+		const FSentrySpanRecord& Span = Transaction.Spans[Index];
+		sentry_value_set_by_key(Value, "trace_id", sentry_value_new_string(TraceId));
+		sentry_value_set_by_key(Value, "span_id", NewString(Transaction.GetSpanId(Index)));
+		sentry_value_set_by_key(Value, "op", sentry_value_new_string(Transaction.GetText(Span.Operation)));
+		if (Span.Status >= 0 && Span.Status < (int8)UE_ARRAY_COUNT(StatusNames))
+		{
+			sentry_value_set_by_key(Value, "status", sentry_value_new_string(StatusNames[Span.Status]));
+		}
+
+		// each key has a single entry
+		sentry_value_t tags = sentry_value_new_object();
+		sentry_value_t data = sentry_value_new_object();
+		for (int32 i = Span.FirstAttribute; i != INDEX_NONE; i = Transaction.Attributes[i].Next)
+		{
+			const FSentrySpanAttribute& Attribute = Transaction.Attributes[i];
+			sentry_value_set_by_key(Attribute.bTag ? tags : data, Transaction.GetText(Attribute.Key), Attribute.String != INDEX_NONE ?
+				sentry_value_new_string(Transaction.GetText(Attribute.String)) : sentry_value_new_double(Attribute.Number));
+		}
+		if (Index == 0 && Transaction.DroppedSpans)
+		{
+			sentry_value_set_by_key(data, "dropped_spans", sentry_value_new_int32((int32_t)Transaction.DroppedSpans));
+		}
+		if (sentry_value_get_length(tags))
+		{
+			sentry_value_set_by_key(Value, "tags", tags);
+		}
+		else
+		{
+			sentry_value_decref(tags);
+		}
+		if (sentry_value_get_length(data))
+		{
+			sentry_value_set_by_key(Value, "data", data);
+		}
+		else
+		{
+			sentry_value_decref(data);
+		}
+	}
+}
+
+
+void FSentryTransactionRecord::Begin(const FString& InName, const FString& Operation, int32 InMaxSpans)
+{
+	Spans.Reset();
+	Attributes.Reset();
+	Text.Reset();
+	TextOffsets.Reset();
+	UserId = INDEX_NONE;
+	Map = INDEX_NONE;
+	TraceId = FGuid::NewGuid();
+	// not from FMath::Rand(), which is the game's seeded stream and has only 15 bits on some platforms
+	const FGuid SpanGuid = FGuid::NewGuid();
+	SpanIdBase = ((uint64)SpanGuid.A << 32 | SpanGuid.B) | (1ull << 63);
+	MaxSpans = InMaxSpans;
+	DroppedSpans = 0;
+	ProfileFirst = INDEX_NONE;
+	ProfileLast = INDEX_NONE;
+	RefCount = 1;
+	bFinished = false;
+
+	Name = AddText(InName);
+	AddSpan(INDEX_NONE, AddText(Operation), INDEX_NONE, FPlatformTime::Seconds());
+	StartUnixTime = (FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTotalSeconds();
+}
+
+void FSentryTransactionRecord::CopyFinished(const FSentryTransactionRecord& Other)
+{
+	Spans = Other.Spans;
+	Attributes = Other.Attributes;
+	Text = Other.Text;
+	// only needed while recording
+	TextOffsets.Reset();
+	Name = Other.Name;
+	UserId = Other.UserId;
+	Map = Other.Map;
+	TraceId = Other.TraceId;
+	SpanIdBase = Other.SpanIdBase;
+	StartUnixTime = Other.StartUnixTime;
+	MaxSpans = Other.MaxSpans;
+	DroppedSpans = Other.DroppedSpans;
+	ProfileFirst = Other.ProfileFirst;
+	ProfileLast = Other.ProfileLast;
+	RefCount = 0;
+	bFinished = true;
+}
+
+int32 FSentryTransactionRecord::AddText(const FString& Value)
+{
+	FTCHARToUTF8 Utf8(*Value);
+	return AddText((const ANSICHAR*)Utf8.Get(), Utf8.Length());
+}
+
+int32 FSentryTransactionRecord::AddText(const ANSICHAR* Value)
+{
+	return AddText(Value, FCStringAnsi::Strlen(Value));
+}
+
+int32 FSentryTransactionRecord::AddText(const ANSICHAR* Value, int32 Length)
+{
+	// operations, descriptions and keys repeat a lot
+	const uint64 Hash = CityHash64(Value, Length);
+	if (const int32* Found = TextOffsets.Find(Hash))
+	{
+		if (FCStringAnsi::Strncmp(&Text[*Found], Value, Length) == 0 && Text[*Found + Length] == '\0')
+		{
+			return *Found;
+		}
+	}
+	if (Text.Num() + Length + 1 > MaxText)
+	{
+		return INDEX_NONE;
+	}
+	const int32 Offset = Text.Num();
+	Text.Append(Value, Length);
+	Text.Add('\0');
+	TextOffsets.Add(Hash, Offset);
+	return Offset;
+}
+
+int32 FSentryTransactionRecord::AddSpan(int32 Parent, int32 Operation, int32 Description, double StartTime)
+{
+	// the transaction itself doesn't count
+	if (Spans.Num() > MaxSpans)
+	{
+		DroppedSpans++;
+		return INDEX_NONE;
+	}
+	Spans.Add({ Parent, Operation, Description, INDEX_NONE, StartTime, 0.0, -1 });
+	return Spans.Num() - 1;
+}
+
+void FSentryTransactionRecord::AddAttribute(int32 Span, int32 Key, int32 String, double Number, bool bTag)
+{
+	// keys are stored once in the text, so the same key has the same offset.  A span updating a
+	// value every frame keeps a single entry.
+	for (int32 i = Spans[Span].FirstAttribute; i != INDEX_NONE; i = Attributes[i].Next)
+	{
+		FSentrySpanAttribute& Attribute = Attributes[i];
+		if (Attribute.Key == Key && Attribute.bTag == bTag)
+		{
+			Attribute.String = String;
+			Attribute.Number = Number;
+			return;
+		}
+	}
+	Attributes.Add({ Spans[Span].FirstAttribute, Key, String, Number, bTag });
+	Spans[Span].FirstAttribute = Attributes.Num() - 1;
+}
+
+SIZE_T FSentryTransactionRecord::GetAllocatedSize() const
+{
+	return Spans.GetAllocatedSize() + Attributes.GetAllocatedSize() + Text.GetAllocatedSize() + TextOffsets.GetAllocatedSize();
+}
+
+
+FSentrySpanRecorder::FSentrySpanRecorder(TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> InTransport,
+	const FString& InRelease, const FString& InEnvironment, bool bInConsentRequired, bool bTailSampling)
+	: Transport(InTransport)
+	, Release(InRelease)
+	, Environment(InEnvironment)
+	, bConsentRequired(bInConsentRequired)
+{
+	MaxSpans = FMath::Max(1, USentryClientConfig::GetConfigInt(TEXT("MAX_SPANS"), USentryClientConfig::Get()->MaxSpans));
+
+	// the scope of the sdk doesn't apply to transactions sent from here, set the same tags
+	Tags = USentryClientConfig::GetTags();
+	Tags.Add(TEXT("hostname"), FPlatformProcess::ComputerName());
+
+	if (bTailSampling)
+	{
+		TailSampler = MakeUnique<FSentryTailSampler>();
+	}
+
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	ProfilesSampleRate = USentryClientConfig::GetConfigFloat(TEXT("PROFILES_SAMPLE_RATE"), Config->ProfilesSampleRate);
+	if (ProfilesSampleRate > 0.0f)
+	{
+		ProfilesRandom.Initialize(GetTypeHash(FGuid::NewGuid()));
+		Profiler = MakeUnique<FSentryProfiler>(
+			USentryClientConfig::GetConfigFloat(TEXT("PROFILING_FREQUENCY"), Config->ProfilingFrequency),
+			USentryClientConfig::GetConfigFloat(TEXT("PROFILING_MAX_DURATION"), Config->ProfilingMaxDuration));
+		if (!Profiler->IsAvailable())
+		{
+			Profiler.Reset();
+		}
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	Active = this;
+}
+
+FSentrySpanRecorder::~FSentrySpanRecorder()
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		Active = nullptr;
+		for (FSentryTransactionRecord* Record : Pool)
+		{
+			delete Record;
+		}
+		Pool.Reset();
+	}
+
+	// Nothing reads the samples once the recorder is inactive.  This deletes the timer, and
+	// waits for a sample being taken before the ring is freed.
+	Profiler.Reset();
+}
+
+FSentryTransactionRecord* FSentrySpanRecorder::NewTransaction(const FString& Name, const FString& Operation)
+{
+	FSentryTransactionRecord* Record = nullptr;
+	int32 MaxSpans;
+	int64 ProfileFirst = INDEX_NONE;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (!Active)
+		{
+			return nullptr;
+		}
+		MaxSpans = Active->MaxSpans;
+		if (Active->Pool.Num())
+		{
+			Record = Active->Pool.Pop(false);
+		}
+		if (Active->Profiler && Active->ProfilesRandom.FRand() < Active->ProfilesSampleRate)
+		{
+			ProfileFirst = Active->Profiler->Begin();
+		}
+	}
+	if (!Record)
+	{
+		Record = new FSentryTransactionRecord();
+	}
+	Record->Begin(Name, Operation, MaxSpans);
+	Record->ProfileFirst = ProfileFirst;
+	return Record;
+}
+
+void FSentrySpanRecorder::Recycle(FSentryTransactionRecord* Transaction)
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (Active && Active->Pool.Num() < MaxPooled && Transaction->GetAllocatedSize() <= MaxPooledSize)
+		{
+			Active->Pool.Add(Transaction);
+			return;
+		}
+	}
+	delete Transaction;
+}
+
+void FSentrySpanRecorder::Submit(FSentryTransactionRecord& Transaction)
+{
+	FSentryTraceSnapshot::OnTransactionFinished(Transaction);
+
+	// only the decision and what the send needs are taken under the lock
+	FSentryTransactionRecord* Copy = nullptr;
+	TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> SendTransport;
+	FSentryProfiler::FSamples SendProfile;
+	FString SendRelease;
+	FString SendEnvironment;
+	TMap<FString, FString> SendTags;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (!Active)
+		{
+			return;
+		}
+		if (Transaction.ProfileFirst != INDEX_NONE && Active->Profiler)
+		{
+			Transaction.ProfileLast = Active->Profiler->End();
+		}
+		if (Active->TailSampler && !Active->TailSampler->ShouldSend(Transaction))
+		{
+			return;
+		}
+		// sentry drops everything when consent is required and not given
+		if (Active->bConsentRequired && sentry_user_consent_get() != SENTRY_USER_CONSENT_GIVEN)
+		{
+			return;
+		}
+		if (Active->Pool.Num())
+		{
+			Copy = Active->Pool.Pop(false);
+		}
+		SendTransport = Active->Transport;
+		// the samples are copied while the profiler can't go away, and encoded with the rest
+		if (Transaction.ProfileFirst != INDEX_NONE && Active->Profiler)
+		{
+			SendProfile = Active->Profiler->CopySamples(Transaction.ProfileFirst, Transaction.ProfileLast);
+		}
+		SendRelease = Active->Release;
+		SendEnvironment = Active->Environment;
+		SendTags = Active->Tags;
+	}
+
+	// the record is released by the caller, the copy is converted and sent off the finishing thread
+	if (!Copy)
+	{
+		Copy = new FSentryTransactionRecord();
+	}
+	Copy->CopyFinished(Transaction);
+	Async(EAsyncExecution::ThreadPool, [Copy, SendTransport, SendProfile = MoveTemp(SendProfile), SendRelease = MoveTemp(SendRelease),
+		SendEnvironment = MoveTemp(SendEnvironment), SendTags = MoveTemp(SendTags)]()
+	{
+		const FString EventId = FGuid::NewGuid().ToString(EGuidFormats::Digits).ToLower();
+		SendTransport->SendEnvelope(EventId, Serialize(*Copy, EventId, SendRelease, SendEnvironment, SendTags, &SendProfile));
+		Recycle(Copy);
+	});
+}
+
+void FSentrySpanRecorder::Discard(FSentryTransactionRecord& Transaction)
+{
+	// the profiler samples while any profiled transaction is running
+	FScopeLock ScopeLock(&Lock);
+	if (Active && Active->Profiler && Transaction.ProfileFirst != INDEX_NONE)
+	{
+		Active->Profiler->End();
+	}
+}
+
+FString FSentrySpanRecorder::GetBaggage(const FSentryTransactionRecord& Transaction)
+{
+	FString Baggage = FString::Printf(TEXT("sentry-trace_id=%s,sentry-sampled=true,sentry-transaction=%s"),
+		*Transaction.TraceId.ToString(EGuidFormats::Digits).ToLower(),
+		*FGenericPlatformHttp::UrlEncode(UTF8_TO_TCHAR(Transaction.GetText(Transaction.Name))));
+
+	FScopeLock ScopeLock(&Lock);
+	if (Active && !Active->Release.IsEmpty())
+	{
+		Baggage += TEXT(",sentry-release=") + FGenericPlatformHttp::UrlEncode(Active->Release);
+	}
+	if (Active && !Active->Environment.IsEmpty())
+	{
+		Baggage += TEXT(",sentry-environment=") + FGenericPlatformHttp::UrlEncode(Active->Environment);
+	}
+	return Baggage;
+}
+
+void FSentrySpanRecorder::Tick()
+{
+	if (TailSampler)
+	{
+		TailSampler->Tick();
+	}
+}
+
+TArray<FSentryEnvelopeItem> FSentrySpanRecorder::Serialize(const FSentryTransactionRecord& Transaction, const FString& EventId,
+	const FString& Release, const FString& Environment, const TMap<FString, FString>& Tags,
+	const FSentryProfiler::FSamples* Profile)
+{
+	const FSentrySpanRecord& Root = Transaction.Spans[0];
+	auto ToUnix = [&Transaction, &Root](double Time)
+	{
+		return sentry_value_new_double(Transaction.StartUnixTime + (Time - Root.StartTime));
+	};
+
+	const FTCHARToUTF8 TraceId(*Transaction.TraceId.ToString(EGuidFormats::Digits).ToLower());
+
+	sentry_value_t event = sentry_value_new_object();
+	sentry_value_set_by_key(event, "type", sentry_value_new_string("transaction"));
+	sentry_value_set_by_key(event, "event_id", NewString(EventId));
+	sentry_value_set_by_key(event, "transaction", sentry_value_new_string(Transaction.GetText(Transaction.Name)));
+	sentry_value_set_by_key(event, "platform", sentry_value_new_string("native"));
+	sentry_value_set_by_key(event, "start_timestamp", ToUnix(Root.StartTime));
+	sentry_value_set_by_key(event, "timestamp", ToUnix(Root.EndTime));
+	if (!Release.IsEmpty())
+	{
+		sentry_value_set_by_key(event, "release", NewString(Release));
+	}
+	if (!Environment.IsEmpty())
+	{
+		sentry_value_set_by_key(event, "environment", NewString(Environment));
+	}
+
+	sentry_value_t sdk = sentry_value_new_object();
+	sentry_value_set_by_key(sdk, "name", sentry_value_new_string(SENTRY_SDK_NAME));
+	sentry_value_set_by_key(sdk, "version", sentry_value_new_string(SENTRY_SDK_VERSION));
+	sentry_value_set_by_key(event, "sdk", sdk);
+
+	// the transaction's own tags go into the trace context, move them to the event
+	sentry_value_t trace = sentry_value_new_object();
+	SetSpanFields(trace, Transaction, 0, (const ANSICHAR*)TraceId.Get());
+	sentry_value_set_by_key(trace, "type", sentry_value_new_string("trace"));
+	sentry_value_t tags = sentry_value_get_by_key_owned(trace, "tags");
+	sentry_value_remove_by_key(trace, "tags");
+	if (sentry_value_is_null(tags))
+	{
+		tags = sentry_value_new_object();
+	}
+	for (const auto& Tag : Tags)
+	{
+		if (sentry_value_is_null(sentry_value_get_by_key(tags, TCHAR_TO_UTF8(*Tag.Key))))
+		{
+			sentry_value_set_by_key(tags, TCHAR_TO_UTF8(*Tag.Key), NewString(Tag.Value));
+		}
+	}
+	if (Transaction.Map != INDEX_NONE)
+	{
+		sentry_value_set_by_key(tags, "map", sentry_value_new_string(Transaction.GetText(Transaction.Map)));
+	}
+	sentry_value_set_by_key(event, "tags", tags);
+
+	sentry_value_t contexts = sentry_value_new_object();
+	sentry_value_set_by_key(contexts, "trace", trace);
+	sentry_value_set_by_key(event, "contexts", contexts);
+
+	if (Transaction.UserId != INDEX_NONE)
+	{
+		sentry_value_t user = sentry_value_new_object();
+		sentry_value_set_by_key(user, "id", sentry_value_new_string(Transaction.GetText(Transaction.UserId)));
+		sentry_value_set_by_key(event, "user", user);
+	}
+
+	// spans which were not finished with the transaction are dropped, like sentry does
+	sentry_value_t spans = sentry_value_new_list();
+	for (int32 i = 1; i < Transaction.Spans.Num(); i++)
+	{
+		const FSentrySpanRecord& Span = Transaction.Spans[i];
+		if (Span.EndTime == 0.0)
+		{
+			continue;
+		}
+		sentry_value_t span = sentry_value_new_object();
+		SetSpanFields(span, Transaction, i, (const ANSICHAR*)TraceId.Get());
+		sentry_value_set_by_key(span, "parent_span_id", NewString(Transaction.GetSpanId(Span.Parent)));
+		sentry_value_set_by_key(span, "description", sentry_value_new_string(Transaction.GetText(Span.Description)));
+		sentry_value_set_by_key(span, "start_timestamp", ToUnix(Span.StartTime));
+		sentry_value_set_by_key(span, "timestamp", ToUnix(Span.EndTime));
+		sentry_value_append(spans, span);
+	}
+	sentry_value_set_by_key(event, "spans", spans);
+
+	TArray<FSentryEnvelopeItem> Items;
+	Items.Add(FSentryEnvelopeItem::FromValue(TEXT("transaction"), event));
+
+	// the profile goes in the same envelope, linked by the event id
+	if (Profile && Profile->Samples.Num())
+	{
+		sentry_value_t profile = FSentryProfiler::MakeProfile(*Profile, Transaction, EventId, Release, Environment);
+		if (!sentry_value_is_null(profile))
+		{
+			Items.Add(FSentryEnvelopeItem::FromValue(TEXT("profile"), profile));
+		}
+	}
+	return Items;
+}
+
+
+#if !UE_BUILD_SHIPPING
+
+// Sentry.BenchmarkSpans [Spans]: the cost of recording spans, and of converting them when sent
+static FAutoConsoleCommand BenchmarkSpansCommand(
+	TEXT("Sentry.BenchmarkSpans"),
+	TEXT("Measure recording and serializing transaction spans.  Argument: number of spans (default 100000)."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumSpans = Args.Num() ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100000;
+		FSentryTransactionRecord Record;
+
+		// two passes, the second with the buffers of the first, as with a pooled record
+		double RecordTime = 0.0;
+		for (int32 Pass = 0; Pass < 2; Pass++)
+		{
+			const double Start = FPlatformTime::Seconds();
+			Record.Begin(TEXT("benchmark"), TEXT("benchmark"), NumSpans);
+			for (int32 i = 0; i < NumSpans; i++)
+			{
+				const int32 Span = Record.AddSpan(0, Record.AddText("bench.op"), Record.AddText("a benchmark span"), FPlatformTime::Seconds());
+				if (Span != INDEX_NONE)
+				{
+					Record.AddAttribute(Span, Record.AddText("index"), INDEX_NONE, (double)i, false);
+					Record.Spans[Span].EndTime = FPlatformTime::Seconds();
+				}
+			}
+			Record.Spans[0].EndTime = FPlatformTime::Seconds();
+			RecordTime = Record.Spans[0].EndTime - Start;
+		}
+
+		const double SerializeStart = FPlatformTime::Seconds();
+		const TArray<FSentryEnvelopeItem> Items = FSentrySpanRecorder::Serialize(Record, FGuid::NewGuid().ToString(EGuidFormats::Digits).ToLower(),
+			FString(), FString(), TMap<FString, FString>());
+		const double SerializeTime = FPlatformTime::Seconds() - SerializeStart;
+		int64 Size = 0;
+		for (const FSentryEnvelopeItem& Item : Items)
+		{
+			Size += Item.Payload.Num();
+		}
+
+		const int32 Recorded = Record.Spans.Num() - 1;
+		UE_LOG(LogSentryClient, Display, TEXT("%d spans (%u dropped): recording %.0f spans/s, %.1f bytes/span; serializing %.0f spans/s, %.1f bytes/span"),
+			Recorded, Record.DroppedSpans,
+			Recorded / FMath::Max(RecordTime, 1e-9), (double)Record.GetAllocatedSize() / FMath::Max(Recorded, 1),
+			Recorded / FMath::Max(SerializeTime, 1e-9), (double)Size / FMath::Max(Recorded, 1));
+	}));
+
+#endif
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "SentryCore.h"
+#include "SentryProfiler.h"
+#include "SentryTransport.h"
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "Math/RandomStream.h"
+#include "Misc/Guid.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+class FSentryTransport;
+class FSentryTailSampler;
+
+// A span recorded by the plugin.  Plain data, strings are offsets into the text of the transaction.
+struct FSentrySpanRecord
+{
+	// index of the parent span, INDEX_NONE for the transaction itself
+	int32 Parent;
+	int32 Operation;
+	int32 Description;
+	// first of the span's tags and data in FSentryTransactionRecord::Attributes, INDEX_NONE if none
+	int32 FirstAttribute;
+	// FPlatformTime::Seconds(), EndTime is 0 while running
+	double StartTime;
+	double EndTime;
+	// an ESentrySpanStatus, or -1 if not set
+	int8 Status;
+};
+
+// A tag or data item of a span, kept in a list per span.  Setting a key again overwrites its entry.
+struct FSentrySpanAttribute
+{
+	int32 Next;
+	int32 Key;
+	// text offset of a string value, INDEX_NONE for a number
+	int32 String;
+	double Number;
+	bool bTag;
+};
+
+// A transaction recorded by the plugin, Spans[0] being the transaction itself.  Records
+// are pooled and keep their buffers, so that recording doesn't allocate once warmed up.
+// Owned by the handles referring to it, and modified under the tracing lock until finished.
+struct FSentryTransactionRecord
+{
+	// text of a transaction is limited, further strings are recorded as empty
+	static constexpr int32 MaxText = 1024 * 1024;
+
+	TArray<FSentrySpanRecord> Spans;
+	TArray<FSentrySpanAttribute> Attributes;
+	// null terminated UTF-8 strings, each stored once
+	TArray<ANSICHAR> Text;
+	TMap<uint64, int32> TextOffsets;
+
+	int32 Name = INDEX_NONE;
+	int32 UserId = INDEX_NONE;
+	int32 Map = INDEX_NONE;
+	FGuid TraceId;
+	// the id of a span is this plus its index
+	uint64 SpanIdBase = 0;
+	// wall clock time at Spans[0].StartTime, in seconds since the unix epoch
+	double StartUnixTime = 0.0;
+
+	int32 MaxSpans = 1000;
+	// spans not recorded because of MaxSpans
+	uint32 DroppedSpans = 0;
+
+	// samples of the profiler taken during the transaction, INDEX_NONE if it is not profiled
+	int64 ProfileFirst = INDEX_NONE;
+	int64 ProfileLast = INDEX_NONE;
+
+	int32 RefCount = 0;
+	bool bFinished = false;
+
+	// Start recording a new transaction into this record
+	void Begin(const FString& InName, const FString& Operation, int32 InMaxSpans);
+	// Copy a finished transaction into this record, reusing its buffers.  The copy can't be recorded into.
+	void CopyFinished(const FSentryTransactionRecord& Other);
+
+	int32 AddText(const FString& Value);
+	int32 AddText(const ANSICHAR* Value);
+	int32 AddText(const ANSICHAR* Value, int32 Length);
+	const ANSICHAR* GetText(int32 Offset) const { return Offset == INDEX_NONE ? "" : &Text[Offset]; }
+
+	// returns the index of the new span, INDEX_NONE when the limit is reached
+	int32 AddSpan(int32 Parent, int32 Operation, int32 Description, double StartTime);
+	void AddAttribute(int32 Span, int32 Key, int32 String, double Number, bool bTag);
+
+	double GetDuration() const { return Spans[0].EndTime - Spans[0].StartTime; }
+	bool IsError() const { return Spans[0].Status > 0; }
+	FString GetSpanId(int32 Span) const { return FString::Printf(TEXT("%016llx"), SpanIdBase + Span); }
+
+	// bytes held by the buffers, recording into a record doesn't allocate until they are full
+	SIZE_T GetAllocatedSize() const;
+};
+
+// Records the transactions of the plugin's tracing API locally, and converts them to
+// sentry events only when they are finished and sent.  With tail sampling, only
+// those which the tail sampler picks are sent.  Transactions started while there is
+// no recorder are recorded by sentry directly.
+class FSentrySpanRecorder
+{
+public:
+	FSentrySpanRecorder(TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> InTransport,
+		const FString& InRelease, const FString& InEnvironment, bool bInConsentRequired, bool bTailSampling);
+	~FSentrySpanRecorder();
+
+	// A new record if the recorder is running, else nullptr.  Thread safe.
+	static FSentryTransactionRecord* NewTransaction(const FString& Name, const FString& Operation);
+
+	// Called with a finished transaction, on the thread which finished it.  A transaction which
+	// is sent is copied, and converted and sent from a worker thread.  Thread safe.
+	static void Submit(FSentryTransactionRecord& Transaction);
+
+	// Called with a transaction which was given up on, instead of Submit.  Nothing is sent.  Thread safe.
+	static void Discard(FSentryTransactionRecord& Transaction);
+
+	// Return a record which is no longer referenced.  Thread safe.
+	static void Recycle(FSentryTransactionRecord* Transaction);
+
+	// The baggage header for requests made within a transaction, the dynamic sampling
+	// context of https://develop.sentry.dev/sdk/performance/dynamic-sampling-context/
+	static FString GetBaggage(const FSentryTransactionRecord& Transaction);
+
+	// Call on the game thread, once per frame
+	void Tick();
+
+	// The transaction as the items of an envelope with the event id.  With the samples copied
+	// for a profiled transaction, its profile is added to them.
+	static TArray<FSentryEnvelopeItem> Serialize(const FSentryTransactionRecord& Transaction, const FString& EventId,
+		const FString& Release, const FString& Environment, const TMap<FString, FString>& Tags,
+		const FSentryProfiler::FSamples* Profile = nullptr);
+
+private:
+	// records kept for reuse, records holding more than MaxPooledSize bytes are freed instead
+	static constexpr int32 MaxPooled = 8;
+	static constexpr SIZE_T MaxPooledSize = 256 * 1024;
+
+	// the recorder which is running, protected by Lock along with the pool
+	static FSentrySpanRecorder* Active;
+	static FCriticalSection Lock;
+	TArray<FSentryTransactionRecord*> Pool;
+
+	TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> Transport;
+	FString Release;
+	FString Environment;
+	bool bConsentRequired = false;
+	TMap<FString, FString> Tags;
+	int32 MaxSpans = 1000;
+
+	TUniquePtr<FSentryTailSampler> TailSampler;
+
+	// fraction of the recorded transactions which are profiled, picked with a stream of our own
+	// rather than the game's, protected by Lock
+	float ProfilesSampleRate = 0.0f;
+	FRandomStream ProfilesRandom;
+	// read under Lock only, sends in flight get a copy of the samples
+	TUniquePtr<FSentryProfiler> Profiler;
+};
+
+#endif
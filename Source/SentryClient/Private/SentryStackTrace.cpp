@@ -0,0 +1,139 @@
+#include "SentryStackTrace.h"
+
+#include "HAL/PlatformStackWalk.h"
+#include "HAL/ThreadManager.h"
+#include "Containers/LruCache.h"
+#include "Misc/ScopeLock.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+// don't walk more than this many threads for a single event
+static const int32 MaxThreads = 64;
+
+// number of resolved program counters to keep around
+static const int32 SymbolCacheSize = 4096;
+
+namespace
+{
+	struct FSentrySymbol
+	{
+		FString Function;
+		FString File;
+		int32 Line = 0;
+	};
+
+	FCriticalSection SymbolCacheLock;
+	TLruCache<uint64, FSentrySymbol> SymbolCache(SymbolCacheSize);
+
+	FSentrySymbol ResolveSymbol(uint64 ProgramCounter)
+	{
+		{
+			FScopeLock Lock(&SymbolCacheLock);
+			if (const FSentrySymbol* Found = SymbolCache.FindAndTouch(ProgramCounter))
+			{
+				return *Found;
+			}
+		}
+
+		// resolve outside the lock, this is the slow part
+		FProgramCounterSymbolInfo Info;
+		FPlatformStackWalk::ProgramCounterToSymbolInfo(ProgramCounter, Info);
+		FSentrySymbol Symbol;
+		Symbol.Function = ANSI_TO_TCHAR(Info.FunctionName);
+		Symbol.File = ANSI_TO_TCHAR(Info.Filename);
+		Symbol.Line = Info.LineNumber;
+
+		FScopeLock Lock(&SymbolCacheLock);
+		SymbolCache.Add(ProgramCounter, Symbol);
+		return Symbol;
+	}
+}
+
+sentry_value_t FSentryStackTrace::FromAddresses(const uint64* Frames, int32 NumFrames)
+{
+	void* ips[MaxFrames];
+	NumFrames = FMath::Min(NumFrames, MaxFrames);
+	for (int32 i = 0; i < NumFrames; i++)
+	{
+		ips[i] = (void*)Frames[i];
+	}
+	return sentry_value_new_stacktrace(ips, (size_t)NumFrames);
+}
+
+void FSentryStackTrace::Symbolicate(sentry_value_t Stacktrace)
+{
+	FPlatformStackWalk::InitStackWalking();
+
+	sentry_value_t frames = sentry_value_get_by_key(Stacktrace, "frames");
+	const size_t NumFrames = sentry_value_get_length(frames);
+	for (size_t i = 0; i < NumFrames; i++)
+	{
+		sentry_value_t frame = sentry_value_get_by_index(frames, i);
+		const char* Address = sentry_value_as_string(sentry_value_get_by_key(frame, "instruction_addr"));
+		const uint64 ProgramCounter = FCStringAnsi::Strtoui64(Address, nullptr, 16);
+		if (ProgramCounter == 0)
+		{
+			continue;
+		}
+
+		FSentrySymbol Symbol = ResolveSymbol(ProgramCounter);
+		if (!Symbol.Function.IsEmpty())
+		{
+			sentry_value_set_by_key(frame, "function", sentry_value_new_string(TCHAR_TO_UTF8(*Symbol.Function)));
+		}
+		if (!Symbol.File.IsEmpty())
+		{
+			sentry_value_set_by_key(frame, "filename", sentry_value_new_string(TCHAR_TO_UTF8(*Symbol.File)));
+			sentry_value_set_by_key(frame, "lineno", sentry_value_new_int32(Symbol.Line));
+		}
+	}
+}
+
+sentry_value_t FSentryStackTrace::CaptureThread(uint32 ThreadId, const FString& ThreadName)
+{
+	uint64 Frames[MaxFrames];
+	int32 NumFrames = (int32)FPlatformStackWalk::CaptureThreadStackBackTrace(ThreadId, Frames, MaxFrames);
+	if (NumFrames <= 0)
+	{
+		return sentry_value_new_null();
+	}
+
+	sentry_value_t thread = sentry_value_new_thread(ThreadId, TCHAR_TO_UTF8(*ThreadName));
+	sentry_value_set_by_key(thread, "stacktrace", FromAddresses(Frames, NumFrames));
+	return thread;
+}
+
+void FSentryStackTrace::AddAllThreads(sentry_value_t Event, uint32 ExceptThread, sentry_value_t* OutGameThreadStack)
+{
+	// collect the threads first, we don't want to walk stacks while holding the thread manager lock
+	TArray<TPair<uint32, FString>> Threads;
+	Threads.Emplace(GGameThreadId, TEXT("GameThread"));
+	FThreadManager::Get().ForEachThread([&Threads, ExceptThread](uint32 ThreadId, FRunnableThread* Thread)
+	{
+		if (ThreadId != ExceptThread && ThreadId != GGameThreadId && Threads.Num() < MaxThreads)
+		{
+			Threads.Emplace(ThreadId, Thread->GetThreadName());
+		}
+	});
+
+	for (auto& Thread : Threads)
+	{
+		sentry_value_t value = CaptureThread(Thread.Key, Thread.Value);
+		if (sentry_value_is_null(value))
+		{
+			continue;
+		}
+		if (Thread.Key == GGameThreadId)
+		{
+			sentry_value_set_by_key(value, "current", sentry_value_new_bool(1));
+			if (OutGameThreadStack)
+			{
+				*OutGameThreadStack = sentry_value_get_by_key_owned(value, "stacktrace");
+			}
+		}
+		sentry_event_add_thread(Event, value);
+	}
+}
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+// Helpers to turn native call stacks into sentry values
+class FSentryStackTrace
+{
+public:
+	// Largest number of frames we capture for a single thread
+	static constexpr int32 MaxFrames = 64;
+
+	// Create a sentry stacktrace from a list of program counters, innermost frame first.
+	static sentry_value_t FromAddresses(const uint64* Frames, int32 NumFrames);
+
+	// Add function, file and line information to the frames of a sentry stacktrace,
+	// using the local debug information.  Lookups are cached by program counter since
+	// resolving symbols is very slow.
+	static void Symbolicate(sentry_value_t Stacktrace);
+
+	// Capture the stack of another thread and return it as a sentry thread value.
+	// Returns a null value if the stack could not be captured.
+	static sentry_value_t CaptureThread(uint32 ThreadId, const FString& ThreadName);
+
+	// Capture the stacks of the game thread and all threads known to the FThreadManager
+	// and add them to the event.  ExceptThread is not captured (usually the caller).
+	// The game thread stack is also returned in OutGameThreadStack, if non-null.
+	static void AddAllThreads(sentry_value_t Event, uint32 ExceptThread, sentry_value_t* OutGameThreadStack);
+};
+
+#endif
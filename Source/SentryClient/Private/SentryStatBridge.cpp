@@ -0,0 +1,116 @@
+#include "SentryStatBridge.h"
+#include "SentryClientModule.h"
+#include "SentryTracing.h"
+
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Stats/StatsData.h"
+
+
+#if SENTRY_HAVE_PLATFORM && STATS
+
+namespace
+{
+	// FStatsThreadState may only be used on the stats thread.  Not waited for.
+	void RunOnStatsThread(FSimpleDelegateGraphTask::FDelegate Delegate)
+	{
+		const ENamedThreads::Type Thread = FPlatformProcess::SupportsMultithreading() ? ENamedThreads::StatsThread : ENamedThreads::GameThread;
+		FSimpleDelegateGraphTask::CreateAndDispatchWhenReady(Delegate, TStatId(), nullptr, Thread);
+	}
+
+	void EnableStats(int32 Value)
+	{
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 1)
+		StatsPrimaryEnableAdd(Value);
+#else
+		StatsMasterEnableAdd(Value);
+#endif
+	}
+}
+
+FSentryStatBridge::FSentryStatBridge(const FString& Names)
+	: Listener(MakeShared<FListener, ESPMode::ThreadSafe>())
+{
+	TArray<FString> Parts;
+	Names.ParseIntoArray(Parts, TEXT(","), true);
+	for (const FString& Part : Parts)
+	{
+		Listener->StatNames.Add(FName(*Part.TrimStartAndEnd()));
+	}
+	Listener->Threshold = USentryClientConfig::GetConfigFloat(TEXT("STAT_SPAN_THRESHOLD"), USentryClientConfig::Get()->StatSpanThreshold);
+
+	RunOnStatsThread(FSimpleDelegateGraphTask::FDelegate::CreateLambda([StatsListener = Listener]() { StatsListener->Register(); }));
+	UE_LOG(LogSentryClient, Log, TEXT("Reporting %d stats longer than %.1f ms as spans"), Listener->StatNames.Num(), Listener->Threshold);
+}
+
+FSentryStatBridge::~FSentryStatBridge()
+{
+	// the listener stays alive until it is unregistered, the stats thread may be busy or gone at shutdown
+	RunOnStatsThread(FSimpleDelegateGraphTask::FDelegate::CreateLambda([StatsListener = Listener]() { StatsListener->Unregister(); }));
+	if (bStatsEnabled)
+	{
+		EnableStats(-1);
+	}
+}
+
+void FSentryStatBridge::Tick()
+{
+	// stats cost time in every scope, only collect them while there is a transaction to add spans to
+	const bool bActive = GSentryTracingActive.load(std::memory_order_relaxed);
+	if (bActive != bStatsEnabled)
+	{
+		bStatsEnabled = bActive;
+		EnableStats(bActive ? 1 : -1);
+	}
+}
+
+void FSentryStatBridge::FListener::Register()
+{
+	NewFrameHandle = FStatsThreadState::GetLocalState().NewFrameDelegate.AddRaw(this, &FListener::OnNewFrame);
+}
+
+void FSentryStatBridge::FListener::Unregister()
+{
+	FStatsThreadState::GetLocalState().NewFrameDelegate.Remove(NewFrameHandle);
+}
+
+void FSentryStatBridge::FListener::OnNewFrame(int64 Frame)
+{
+	// the frame arrives a few frames late, close enough for a transaction spanning many
+	if (!GSentryTracingActive.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	const FStatsThreadState& Stats = FStatsThreadState::GetLocalState();
+	if (!Stats.IsFrameValid(Frame))
+	{
+		return;
+	}
+	FRawStatStackNode Root;
+	Stats.UncondenseStackStats(Frame, Root);
+	Visit(Root);
+}
+
+void FSentryStatBridge::FListener::Visit(const FRawStatStackNode& Node)
+{
+	for (const auto& Child : Node.Children)
+	{
+		const FRawStatStackNode& ChildNode = *Child.Value;
+		const FName ShortName = ChildNode.Meta.NameAndInfo.GetShortName();
+		if (StatNames.Contains(ShortName))
+		{
+			// stack nodes hold the number of calls and their total duration in the frame
+			const int64 Packed = ChildNode.Meta.GetValue_int64();
+			const double Milliseconds = FPlatformTime::ToMilliseconds64(FromPackedCallCountDuration_Duration(Packed));
+			if (Milliseconds >= Threshold)
+			{
+				FSentryTransaction::AddCurrentSpan(TEXT("stat"), ShortName.ToString(), Milliseconds / 1000.0,
+					FromPackedCallCountDuration_CallCount(Packed));
+			}
+		}
+		Visit(ChildNode);
+	}
+}
+
+#endif // SENTRY_HAVE_PLATFORM && STATS
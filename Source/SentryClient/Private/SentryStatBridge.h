@@ -0,0 +1,48 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+#if SENTRY_HAVE_PLATFORM && STATS
+
+struct FRawStatStackNode;
+
+// Turns selected stat scopes (SCOPE_CYCLE_COUNTER and friends) into spans of the
+// current transaction, when they took longer than a threshold within a frame.
+// The frame history of the stats thread is used, so nothing is added to the
+// scopes themselves.  The stats system is only enabled while there is a current
+// transaction, and frames are only looked at then.
+class FSentryStatBridge
+{
+public:
+	FSentryStatBridge(const FString& Names);
+	~FSentryStatBridge();
+
+	// Call on the game thread, once per frame
+	void Tick();
+
+private:
+	// The part living on the stats thread.  The tasks registering and unregistering it hold
+	// a reference, so that the bridge does not wait for the stats thread.
+	struct FListener
+	{
+		void Register();
+		void Unregister();
+		void OnNewFrame(int64 Frame);
+		void Visit(const FRawStatStackNode& Node);
+
+		// short names of the stats to report, e.g. STAT_UpdateLevelStreaming
+		TSet<FName> StatNames;
+		// milliseconds
+		double Threshold = 5.0;
+
+		FDelegateHandle NewFrameHandle;
+	};
+
+	TSharedRef<FListener, ESPMode::ThreadSafe> Listener;
+	bool bStatsEnabled = false;
+};
+
+#endif
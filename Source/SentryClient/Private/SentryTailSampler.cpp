@@ -0,0 +1,131 @@
+#include "SentryTailSampler.h"
+#include "SentryClientModule.h"
+#include "SentrySpanRecorder.h"
+
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentryTailSampler::FSentryTailSampler()
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	DefaultThreshold = USentryClientConfig::GetConfigFloat(TEXT("TAIL_SAMPLE_THRESHOLD"), Config->TailSampleThreshold);
+	Interval = FMath::Max(10.0f, USentryClientConfig::GetConfigFloat(TEXT("TAIL_SAMPLE_REPORT_INTERVAL"), Config->TailSampleReportInterval));
+
+	// op=milliseconds pairs, separated by commas
+	TArray<FString> Pairs;
+	USentryClientConfig::GetConfig(TEXT("TAIL_SAMPLE_THRESHOLDS"), *Config->TailSampleThresholds).ParseIntoArray(Pairs, TEXT(","), true);
+	for (const FString& Pair : Pairs)
+	{
+		FString Operation, Milliseconds;
+		if (Pair.Split(TEXT("="), &Operation, &Milliseconds))
+		{
+			Thresholds.Add(Operation.TrimStartAndEnd(), FCString::Atod(*Milliseconds.TrimStartAndEnd()));
+		}
+	}
+
+	IntervalStart = FPlatformTime::Seconds();
+}
+
+double FSentryTailSampler::GetThreshold(const FString& Operation) const
+{
+	const double* Found = Thresholds.Find(Operation);
+	return Found ? *Found : DefaultThreshold;
+}
+
+bool FSentryTailSampler::ShouldSend(const FSentryTransactionRecord& Transaction)
+{
+	const FString Operation = UTF8_TO_TCHAR(Transaction.GetText(Transaction.Spans[0].Operation));
+	const double DurationMs = Transaction.GetDuration() * 1000.0;
+	const bool bError = Transaction.IsError();
+	const bool bSend = bError || DurationMs >= GetThreshold(Operation);
+
+	FScopeLock ScopeLock(&Lock);
+	TUniquePtr<FOperationStats>* Found = Stats.Find(Operation);
+	if (!Found)
+	{
+		Found = &Stats.FindOrAdd(Stats.Num() < MaxOperations ? Operation : FString(TEXT("other")));
+		if (!Found->IsValid())
+		{
+			*Found = MakeUnique<FOperationStats>();
+		}
+	}
+	FOperationStats& OpStats = **Found;
+	OpStats.Durations.Record((uint64)FMath::Max(0.0, DurationMs));
+	if (bError)
+	{
+		OpStats.Errors++;
+	}
+	if (bSend)
+	{
+		OpStats.Sent++;
+	}
+	return bSend;
+}
+
+void FSentryTailSampler::Tick()
+{
+	const double Elapsed = FPlatformTime::Seconds() - IntervalStart;
+	if (Elapsed >= Interval)
+	{
+		Report(Elapsed);
+		IntervalStart = FPlatformTime::Seconds();
+	}
+}
+
+void FSentryTailSampler::Report(double Elapsed)
+{
+	sentry_value_t contexts = sentry_value_new_object();
+	int32 Transactions = 0;
+	{
+		FScopeLock ScopeLock(&Lock);
+		for (auto& Elem : Stats)
+		{
+			FOperationStats& OpStats = *Elem.Value;
+			if (OpStats.Durations.GetCount() == 0)
+			{
+				continue;
+			}
+			sentry_value_t stats = sentry_value_new_object();
+			sentry_value_set_by_key(stats, "type", sentry_value_new_string("transaction_durations"));
+			sentry_value_set_by_key(stats, "count", sentry_value_new_int32((int32_t)OpStats.Durations.GetCount()));
+			sentry_value_set_by_key(stats, "sent", sentry_value_new_int32((int32_t)OpStats.Sent));
+			sentry_value_set_by_key(stats, "errors", sentry_value_new_int32((int32_t)OpStats.Errors));
+			sentry_value_set_by_key(stats, "mean_ms", sentry_value_new_double(OpStats.Durations.GetMean()));
+			sentry_value_set_by_key(stats, "p50_ms", sentry_value_new_double((double)OpStats.Durations.GetPercentile(0.50)));
+			sentry_value_set_by_key(stats, "p95_ms", sentry_value_new_double((double)OpStats.Durations.GetPercentile(0.95)));
+			sentry_value_set_by_key(stats, "p99_ms", sentry_value_new_double((double)OpStats.Durations.GetPercentile(0.99)));
+			sentry_value_set_by_key(stats, "max_ms", sentry_value_new_double((double)OpStats.Durations.GetMax()));
+			sentry_value_set_by_key(stats, "threshold_ms", sentry_value_new_double(GetThreshold(Elem.Key)));
+			sentry_value_set_by_key(contexts, TCHAR_TO_UTF8(*Elem.Key), stats);
+
+			Transactions += (int32)OpStats.Durations.GetCount();
+			OpStats.Durations.Reset();
+			OpStats.Sent = 0;
+			OpStats.Errors = 0;
+		}
+	}
+	if (Transactions == 0)
+	{
+		sentry_value_decref(contexts);
+		return;
+	}
+
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_INFO, "sentry.tail", "Transaction duration report");
+	sentry_value_set_by_key(event, "contexts", contexts);
+
+	sentry_value_t extra = sentry_value_new_object();
+	sentry_value_set_by_key(extra, "transactions", sentry_value_new_int32(Transactions));
+	sentry_value_set_by_key(extra, "seconds", sentry_value_new_double(Elapsed));
+	sentry_value_set_by_key(event, "extra", extra);
+
+	sentry_value_t fingerprint = sentry_value_new_list();
+	sentry_value_append(fingerprint, sentry_value_new_string("transaction-duration-report"));
+	sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+	sentry_capture_event(event);
+}
+
+#endif // SENTRY_HAVE_PLATFORM
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "SentryHistogram.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+struct FSentryTransactionRecord;
+
+// Tail based sampling.  Of the transactions recorded by FSentrySpanRecorder, only
+// those which took longer than the threshold for their operation, or ended with an
+// error status, are sent.  The durations of all of them are collected in a
+// histogram per operation, sent as a periodic report.
+class FSentryTailSampler
+{
+public:
+	FSentryTailSampler();
+
+	// Should a finished transaction be sent?  Records its duration.  Thread safe.
+	bool ShouldSend(const FSentryTransactionRecord& Transaction);
+
+	// Call on the game thread, once per frame
+	void Tick();
+
+private:
+	struct FOperationStats
+	{
+		// durations in milliseconds
+		FSentryHistogram Durations;
+		uint32 Sent = 0;
+		uint32 Errors = 0;
+	};
+
+	// distinct operations we keep statistics for, the rest are counted as "other"
+	static constexpr int32 MaxOperations = 32;
+
+	void Report(double Elapsed);
+	double GetThreshold(const FString& Operation) const;
+
+	// configuration
+	double DefaultThreshold = 1000.0;
+	TMap<FString, double> Thresholds;
+	double Interval = 300.0;
+
+	TMap<FString, TUniquePtr<FOperationStats>> Stats;
+	FCriticalSection Lock;
+	double IntervalStart = 0.0;
+};
+
+#endif
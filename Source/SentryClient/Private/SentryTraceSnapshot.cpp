@@ -0,0 +1,237 @@
+#include "SentryTraceSnapshot.h"
+#include "SentryClientModule.h"
+#include "SentrySpanRecorder.h"
+#include "SentryTransport.h"
+
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Runtime/Launch/Resources/Version.h"
+#include "UObject/UObjectGlobals.h"
+
+// FTraceAuxiliary::WriteSnapshot() was added in UE 5.1
+#if ENGINE_MAJOR_VERSION > 5 || (ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 1)
+#include "ProfilingDebugging/TraceAuxiliary.h"
+#include "Trace/Trace.h"
+#define HAVE_TRACE_SNAPSHOT UE_TRACE_ENABLED
+#else
+#define HAVE_TRACE_SNAPSHOT 0
+#endif
+
+
+#if SENTRY_HAVE_PLATFORM
+
+FSentryTraceSnapshot* FSentryTraceSnapshot::Active = nullptr;
+FCriticalSection FSentryTraceSnapshot::Lock;
+
+FSentryTraceSnapshot::FSentryTraceSnapshot(TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> InTransport)
+	: Transport(InTransport)
+{
+	USentryClientConfig* Config = USentryClientConfig::Get();
+	HitchThreshold = (uint64)(USentryClientConfig::GetConfigFloat(TEXT("TRACE_SNAPSHOT_HITCH_THRESHOLD"), Config->TraceSnapshotHitchThreshold) * 1000.0f);
+	TransactionThreshold = USentryClientConfig::GetConfigFloat(TEXT("TRACE_SNAPSHOT_TRANSACTION_THRESHOLD"), Config->TraceSnapshotTransactionThreshold) / 1000.0;
+	MaxSize = (int64)(USentryClientConfig::GetConfigFloat(TEXT("TRACE_SNAPSHOT_MAX_SIZE"), Config->TraceSnapshotMaxSize) * 1024.0 * 1024.0);
+	MaxCount = USentryClientConfig::GetConfigInt(TEXT("TRACE_SNAPSHOTS_PER_SESSION"), Config->TraceSnapshotsPerSession);
+	Cooldown = USentryClientConfig::GetConfigFloat(TEXT("TRACE_SNAPSHOT_COOLDOWN"), Config->TraceSnapshotCooldown);
+
+	if (!IsSupported())
+	{
+		UE_LOG(LogSentryClient, Warning, TEXT("TraceSnapshots is set, but trace snapshots need UE 5.1 and trace support in the build"));
+	}
+
+	// the frame spanning a blocking map load is not a hitch
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &FSentryTraceSnapshot::OnPreLoadMap);
+
+	FScopeLock ScopeLock(&Lock);
+	Active = this;
+}
+
+FSentryTraceSnapshot::~FSentryTraceSnapshot()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	{
+		FScopeLock ScopeLock(&Lock);
+		Active = nullptr;
+	}
+	// no new snapshot can start, wait for one being written
+	if (Task.IsValid())
+	{
+		Task.Wait();
+	}
+}
+
+bool FSentryTraceSnapshot::IsSupported()
+{
+	return HAVE_TRACE_SNAPSHOT != 0;
+}
+
+void FSentryTraceSnapshot::OnPreLoadMap(const FString& MapName)
+{
+	LastFrameCycles = 0;
+}
+
+bool FSentryTraceSnapshot::TryBegin()
+{
+	if (!IsSupported() || bWriting || Count >= MaxCount)
+	{
+		return false;
+	}
+	const double Now = FPlatformTime::Seconds();
+	if (Count > 0 && Now - LastSnapshot < Cooldown)
+	{
+		return false;
+	}
+	Count++;
+	LastSnapshot = Now;
+	bWriting = true;
+	return true;
+}
+
+void FSentryTraceSnapshot::Tick()
+{
+	const uint64 Now = FPlatformTime::Cycles64();
+	const uint64 Micros = LastFrameCycles != 0 ? (uint64)(FPlatformTime::ToSeconds64(Now - LastFrameCycles) * 1000000.0) : 0;
+	LastFrameCycles = Now;
+	if (Micros < HitchThreshold)
+	{
+		return;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	if (!TryBegin())
+	{
+		return;
+	}
+
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_WARNING, "sentry.frametime", "Severe hitch");
+
+	sentry_value_t hitch = sentry_value_new_object();
+	sentry_value_set_by_key(hitch, "type", sentry_value_new_string("hitch"));
+	sentry_value_set_by_key(hitch, "frame_ms", sentry_value_new_double(Micros / 1000.0));
+	sentry_value_set_by_key(hitch, "threshold_ms", sentry_value_new_double(HitchThreshold / 1000.0));
+
+	sentry_value_t contexts = sentry_value_new_object();
+	sentry_value_set_by_key(contexts, "hitch", hitch);
+
+	sentry_value_t fingerprint = sentry_value_new_list();
+	sentry_value_append(fingerprint, sentry_value_new_string("severe-hitch"));
+	sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+	Task = Async(EAsyncExecution::Thread, [this, event, contexts]()
+	{
+		WriteAndSend(event, contexts);
+	});
+}
+
+void FSentryTraceSnapshot::OnTransactionFinished(const FSentryTransactionRecord& Transaction)
+{
+	const FSentrySpanRecord& Root = Transaction.Spans[0];
+	const double Duration = Root.EndTime - Root.StartTime;
+
+	FScopeLock ScopeLock(&Lock);
+	if (!Active || Active->TransactionThreshold <= 0.0 || Duration < Active->TransactionThreshold || !Active->TryBegin())
+	{
+		return;
+	}
+
+	sentry_value_t event = sentry_value_new_message_event(SENTRY_LEVEL_WARNING, "sentry.tracing", "Long transaction");
+	sentry_value_set_by_key(event, "transaction", sentry_value_new_string(Transaction.GetText(Transaction.Name)));
+
+	sentry_value_t transaction = sentry_value_new_object();
+	sentry_value_set_by_key(transaction, "type", sentry_value_new_string("long_transaction"));
+	sentry_value_set_by_key(transaction, "name", sentry_value_new_string(Transaction.GetText(Transaction.Name)));
+	sentry_value_set_by_key(transaction, "op", sentry_value_new_string(Transaction.GetText(Root.Operation)));
+	sentry_value_set_by_key(transaction, "duration_ms", sentry_value_new_double(Duration * 1000.0));
+	sentry_value_set_by_key(transaction, "threshold_ms", sentry_value_new_double(Active->TransactionThreshold * 1000.0));
+
+	// links the event to the transaction, if it is sent
+	sentry_value_t trace = sentry_value_new_object();
+	sentry_value_set_by_key(trace, "trace_id", sentry_value_new_string(TCHAR_TO_UTF8(*Transaction.TraceId.ToString(EGuidFormats::Digits).ToLower())));
+	sentry_value_set_by_key(trace, "span_id", sentry_value_new_string(TCHAR_TO_UTF8(*Transaction.GetSpanId(0))));
+	sentry_value_set_by_key(trace, "op", sentry_value_new_string(Transaction.GetText(Root.Operation)));
+
+	sentry_value_t contexts = sentry_value_new_object();
+	sentry_value_set_by_key(contexts, "long_transaction", transaction);
+	sentry_value_set_by_key(contexts, "trace", trace);
+
+	sentry_value_t fingerprint = sentry_value_new_list();
+	sentry_value_append(fingerprint, sentry_value_new_string("long-transaction"));
+	sentry_value_append(fingerprint, sentry_value_new_string(Transaction.GetText(Transaction.Name)));
+	sentry_value_set_by_key(event, "fingerprint", fingerprint);
+
+	FSentryTraceSnapshot* Snapshot = Active;
+	Active->Task = Async(EAsyncExecution::Thread, [Snapshot, event, contexts]()
+	{
+		Snapshot->WriteAndSend(event, contexts);
+	});
+}
+
+void FSentryTraceSnapshot::WriteAndSend(sentry_value_t Event, sentry_value_t Contexts)
+{
+	sentry_value_t snapshot = sentry_value_new_object();
+	sentry_value_set_by_key(snapshot, "type", sentry_value_new_string("trace_snapshot"));
+
+	TArray<uint8> Data;
+#if HAVE_TRACE_SNAPSHOT
+	// written to a file, which is removed once read back.  Named by the process, servers and
+	// clients started from the same project share the directory.
+	const FString Directory = FPaths::ConvertRelativePathToFull(FPaths::ProfilingDir());
+	const FString Path = FPaths::Combine(Directory, FString::Printf(TEXT("SentrySnapshot-%u.utrace"), FPlatformProcess::GetCurrentProcessId()));
+	IFileManager::Get().MakeDirectory(*Directory, true);
+
+	const double Start = FPlatformTime::Seconds();
+	const char* Status = "attached";
+	if (FTraceAuxiliary::WriteSnapshot(*Path))
+	{
+		const int64 Size = IFileManager::Get().FileSize(*Path);
+		sentry_value_set_by_key(snapshot, "bytes", sentry_value_new_double((double)Size));
+		sentry_value_set_by_key(snapshot, "write_ms", sentry_value_new_double((FPlatformTime::Seconds() - Start) * 1000.0));
+		if (Size > MaxSize)
+		{
+			Status = "too_large";
+		}
+		else if (!FFileHelper::LoadFileToArray(Data, *Path))
+		{
+			Status = "read_failed";
+		}
+		IFileManager::Get().Delete(*Path);
+	}
+	else
+	{
+		Status = "write_failed";
+	}
+	sentry_value_set_by_key(snapshot, "status", sentry_value_new_string(Status));
+	sentry_value_set_by_key(snapshot, "max_bytes", sentry_value_new_double((double)MaxSize));
+#endif
+
+	sentry_value_set_by_key(Contexts, "trace_snapshot", snapshot);
+	sentry_value_set_by_key(Event, "contexts", Contexts);
+	sentry_uuid_t EventId = sentry_capture_event(Event);
+
+	// the attachment goes in its own envelope, sentry associates it with the event by its id
+	if (Data.Num() && !sentry_uuid_is_nil(&EventId))
+	{
+		char Id[37];
+		sentry_uuid_as_string(&EventId, Id);
+		const FString IdString = UTF8_TO_TCHAR(Id);
+		const int32 Size = Data.Num();
+
+		TArray<FSentryEnvelopeItem> Items;
+		FSentryEnvelopeItem& Item = Items.AddDefaulted_GetRef();
+		Item.Type = TEXT("attachment");
+		Item.Headers.Add(TEXT("filename"), TEXT("snapshot.utrace"));
+		Item.Headers.Add(TEXT("content_type"), TEXT("application/octet-stream"));
+		Item.Payload = MoveTemp(Data);
+		Transport->SendEnvelope(IdString, MoveTemp(Items));
+		UE_LOG(LogSentryClient, Log, TEXT("Sent a trace snapshot of %d bytes with event %s"), Size, *IdString);
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	bWriting = false;
+}
+
+#endif // SENTRY_HAVE_PLATFORM
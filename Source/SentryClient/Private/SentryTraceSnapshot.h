@@ -0,0 +1,63 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "HAL/CriticalSection.h"
+
+#if SENTRY_HAVE_PLATFORM
+
+class FSentryTransport;
+struct FSentryTransactionRecord;
+
+// On a severe hitch, or when a transaction recorded by the plugin takes too long, writes an
+// Unreal Insights snapshot of the in-memory trace buffer on a background thread, captures a
+// warning about it, and sends the snapshot as an attachment of that event.  Snapshots are
+// limited in size, in number per session and by a cooldown.  Needs UE 5.1 and trace support
+// compiled in, otherwise IsSupported() is false.
+class FSentryTraceSnapshot
+{
+public:
+	FSentryTraceSnapshot(TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> InTransport);
+	~FSentryTraceSnapshot();
+
+	static bool IsSupported();
+
+	// A recorded transaction finished, takes a snapshot if it ran too long.  Thread safe.
+	static void OnTransactionFinished(const FSentryTransactionRecord& Transaction);
+
+	// Call on the game thread, once per frame
+	void Tick();
+
+private:
+	void OnPreLoadMap(const FString& MapName);
+
+	// Starts a snapshot, unless one is being written or the limits don't allow it.  Call with Lock held.
+	bool TryBegin();
+	// On the background thread: writes the snapshot, captures the event and sends the snapshot with it
+	void WriteAndSend(sentry_value_t Event, sentry_value_t Contexts);
+
+	// the snapshotter which is running, protected by Lock along with the limits
+	static FSentryTraceSnapshot* Active;
+	static FCriticalSection Lock;
+
+	TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> Transport;
+
+	// configuration
+	uint64 HitchThreshold = 1000000;	// microseconds
+	double TransactionThreshold = 0.0;	// seconds, 0 if disabled
+	int64 MaxSize = 0;
+	int32 MaxCount = 1;
+	double Cooldown = 600.0;
+
+	int32 Count = 0;
+	double LastSnapshot = 0.0;
+	bool bWriting = false;
+	TFuture<void> Task;
+
+	uint64 LastFrameCycles = 0;
+	FDelegateHandle PreLoadMapHandle;
+};
+
+#endif
@@ -0,0 +1,720 @@
+#include "SentryTracing.h"
+#include "SentryClientModule.h"
+#include "SentrySpanRecorder.h"
+
+#include "Hash/CityHash.h"
+#include "HAL/PlatformProperties.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/ScopeLock.h"
+
+
+std::atomic<bool> GSentryTracingActive{ false };
+
+#if SENTRY_HAVE_PLATFORM
+
+namespace
+{
+	// sentry-native transactions and spans are not thread safe, finishing a span
+	// modifies its transaction.  Tracing calls are infrequent, a single lock will do.
+	FCriticalSection TracingLock;
+
+	float SampleRate = 0.0f;
+
+	// per transaction sampling, and its inputs.  Protected by TracingLock.
+	FSentryTracesSampler Sampler;
+	FString SamplingUser;
+	FString SamplingMap;
+
+	// parent of SENTRY_SPAN scopes which have no enclosing scope, one or the other
+	sentry_transaction_t* CurrentTransaction = nullptr;
+	FSentryTransactionRecord* CurrentRecord = nullptr;
+
+	// innermost SENTRY_SPAN scope on this thread
+	thread_local FSentrySpanScope* CurrentScope = nullptr;
+
+	sentry_span_status_t ToSentry(ESentrySpanStatus Status)
+	{
+		return (sentry_span_status_t)Status;
+	}
+
+	// Should a transaction be recorded at the given rate?  Deterministic per user id set by the game.
+	bool Sample(float Rate, const FString& UserId)
+	{
+		if (Rate <= 0.0f)
+		{
+			return false;
+		}
+		if (Rate >= 1.0f)
+		{
+			return true;
+		}
+		if (UserId.IsEmpty())
+		{
+			// a stream of our own, FMath::FRand() is the game's seeded stream and not thread safe
+			FScopeLock Lock(&TracingLock);
+			static FRandomStream Random(GetTypeHash(FGuid::NewGuid()));
+			return Random.FRand() < Rate;
+		}
+		// top 53 bits of the hash as a fraction in [0, 1)
+		FTCHARToUTF8 Utf8(*UserId);
+		const uint64 Hash = CityHash64((const char*)Utf8.Get(), Utf8.Length());
+		return (double)(Hash >> 11) * (1.0 / 9007199254740992.0) < Rate;
+	}
+
+	// Transactions recorded by the plugin, see FSentrySpanRecorder.  These are called with
+	// TracingLock held.  Each handle to a transaction or its spans holds a reference.
+	void ReleaseRecord(FSentryTransactionRecord* Record)
+	{
+		if (--Record->RefCount == 0)
+		{
+			FSentrySpanRecorder::Recycle(Record);
+		}
+	}
+
+	// returns the index of the new span, or INDEX_NONE if there is none
+	template <typename TextType>
+	int32 StartRecordSpan(FSentryTransactionRecord* Record, int32 Parent, const TextType& Operation, const TextType& Description)
+	{
+		if (Record->bFinished)
+		{
+			return INDEX_NONE;
+		}
+		if (Record->Spans.Num() > Record->MaxSpans)
+		{
+			Record->DroppedSpans++;
+			return INDEX_NONE;
+		}
+		const int32 Index = Record->AddSpan(Parent, Record->AddText(Operation), Record->AddText(Description), FPlatformTime::Seconds());
+		Record->RefCount++;
+		return Index;
+	}
+
+	void FinishRecordSpan(FSentryTransactionRecord* Record, int32 Index)
+	{
+		if (!Record->bFinished && Record->Spans[Index].EndTime == 0.0)
+		{
+			Record->Spans[Index].EndTime = FPlatformTime::Seconds();
+		}
+		ReleaseRecord(Record);
+	}
+
+	void SetRecordTag(FSentryTransactionRecord* Record, int32 Index, const FString& Key, const FString& Value)
+	{
+		if (!Record->bFinished)
+		{
+			Record->AddAttribute(Index, Record->AddText(Key), Record->AddText(Value), 0.0, true);
+		}
+	}
+
+	void SetRecordData(FSentryTransactionRecord* Record, int32 Index, const FString& Key, const FString* String, double Number)
+	{
+		if (!Record->bFinished)
+		{
+			Record->AddAttribute(Index, Record->AddText(Key), String ? Record->AddText(*String) : INDEX_NONE, Number, false);
+		}
+	}
+
+	void SetRecordStatus(FSentryTransactionRecord* Record, int32 Index, ESentrySpanStatus Status)
+	{
+		if (!Record->bFinished)
+		{
+			Record->Spans[Index].Status = (int8)Status;
+		}
+	}
+}
+
+#endif
+
+FSentryTransaction::FSentryTransaction(FSentryTransaction&& Other)
+	: Transaction(Other.Transaction)
+	, Record(Other.Record)
+{
+	Other.Transaction = nullptr;
+	Other.Record = nullptr;
+}
+
+FSentryTransaction& FSentryTransaction::operator=(FSentryTransaction&& Other)
+{
+	if (this != &Other)
+	{
+		Finish();
+		Transaction = Other.Transaction;
+		Record = Other.Record;
+		Other.Transaction = nullptr;
+		Other.Record = nullptr;
+	}
+	return *this;
+}
+
+FSentryTransaction::~FSentryTransaction()
+{
+	Finish();
+}
+
+void FSentryTransaction::SetSampleRate(float Rate)
+{
+#if SENTRY_HAVE_PLATFORM
+	SampleRate = FMath::Clamp(Rate, 0.0f, 1.0f);
+#endif
+}
+
+bool FSentryTransaction::IsTracingEnabled()
+{
+#if SENTRY_HAVE_PLATFORM
+	FSentryClientModule* Module = FSentryClientModule::Get();
+	return SampleRate > 0.0f && Module && Module->IsInitialized();
+#else
+	return false;
+#endif
+}
+
+void FSentryTransaction::SetSampler(FSentryTracesSampler InSampler)
+{
+#if SENTRY_HAVE_PLATFORM
+	FScopeLock Lock(&TracingLock);
+	Sampler = InSampler;
+#endif
+}
+
+void FSentryTransaction::SetSamplingUser(const FString& UserId)
+{
+#if SENTRY_HAVE_PLATFORM
+	FScopeLock Lock(&TracingLock);
+	SamplingUser = UserId;
+#endif
+}
+
+void FSentryTransaction::SetSamplingMap(const FString& Map)
+{
+#if SENTRY_HAVE_PLATFORM
+	FScopeLock Lock(&TracingLock);
+	SamplingMap = Map;
+#endif
+}
+
+void FSentryTransaction::AddCurrentSpan(const FString& Operation, const FString& Description, double Duration, int32 Calls)
+{
+#if SENTRY_HAVE_PLATFORM
+	FScopeLock Lock(&TracingLock);
+	if (CurrentRecord)
+	{
+		const int32 Index = StartRecordSpan(CurrentRecord, 0, Operation, Description);
+		if (Index != INDEX_NONE)
+		{
+			FSentrySpanRecord& Span = CurrentRecord->Spans[Index];
+			Span.EndTime = Span.StartTime;
+			Span.StartTime = FMath::Max(CurrentRecord->Spans[0].StartTime, Span.EndTime - Duration);
+			SetRecordData(CurrentRecord, Index, TEXT("duration_ms"), nullptr, Duration * 1000.0);
+			SetRecordData(CurrentRecord, Index, TEXT("calls"), nullptr, (double)Calls);
+			// there is no handle for the span, the current transaction keeps the record alive
+			ReleaseRecord(CurrentRecord);
+		}
+	}
+	else if (CurrentTransaction)
+	{
+		sentry_span_t* Span = sentry_transaction_start_child(CurrentTransaction, TCHAR_TO_UTF8(*Operation), TCHAR_TO_UTF8(*Description));
+		if (Span)
+		{
+			sentry_span_set_data(Span, "duration_ms", sentry_value_new_double(Duration * 1000.0));
+			sentry_span_set_data(Span, "calls", sentry_value_new_int32(Calls));
+			sentry_span_finish(Span);
+		}
+	}
+#endif
+}
+
+FSentrySpan FSentryTransaction::StartCurrentChild(const FString& Operation, const FString& Description)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (!GSentryTracingActive.load(std::memory_order_relaxed))
+	{
+		return FSentrySpan();
+	}
+	FScopeLock Lock(&TracingLock);
+	FSentryTransactionRecord* Record = nullptr;
+	int32 Parent = 0;
+	if (CurrentScope && CurrentScope->Record)
+	{
+		Record = CurrentScope->Record;
+		Parent = CurrentScope->RecordIndex;
+	}
+	else if (CurrentScope)
+	{
+		return FSentrySpan(sentry_span_start_child(CurrentScope->Span, TCHAR_TO_UTF8(*Operation), TCHAR_TO_UTF8(*Description)));
+	}
+	else if (CurrentRecord)
+	{
+		Record = CurrentRecord;
+	}
+	else if (CurrentTransaction)
+	{
+		return FSentrySpan(sentry_transaction_start_child(CurrentTransaction, TCHAR_TO_UTF8(*Operation), TCHAR_TO_UTF8(*Description)));
+	}
+	if (Record)
+	{
+		const int32 Index = StartRecordSpan(Record, Parent, Operation, Description);
+		if (Index != INDEX_NONE)
+		{
+			return FSentrySpan(Record, Index);
+		}
+	}
+#endif
+	return FSentrySpan();
+}
+
+FSentryTransaction FSentryTransaction::Start(const FString& Name, const FString& Operation)
+{
+	FSentryTransaction Result;
+#if SENTRY_HAVE_PLATFORM
+	// the sampling decision is made here, so that unsampled transactions cost nothing
+	if (!IsTracingEnabled())
+	{
+		return Result;
+	}
+
+	FSentrySamplingContext SamplingContext;
+	FSentryTracesSampler CurrentSampler;
+	{
+		FScopeLock Lock(&TracingLock);
+		SamplingContext.UserId = SamplingUser;
+		SamplingContext.Map = SamplingMap;
+		CurrentSampler = Sampler;
+	}
+	float Rate = SampleRate;
+	if (CurrentSampler.IsBound())
+	{
+		SamplingContext.Name = Name;
+		SamplingContext.Operation = Operation;
+		SamplingContext.Platform = FPlatformProperties::IniPlatformName();
+		SamplingContext.DefaultRate = SampleRate;
+		Rate = CurrentSampler.Execute(SamplingContext);
+	}
+	if (!Sample(Rate, SamplingContext.UserId))
+	{
+		return Result;
+	}
+
+	// Once the plugin is up, transactions are recorded by it and converted when they are sent
+	if (FSentryTransactionRecord* Record = FSentrySpanRecorder::NewTransaction(Name, Operation))
+	{
+		if (!SamplingContext.UserId.IsEmpty())
+		{
+			Record->UserId = Record->AddText(SamplingContext.UserId);
+		}
+		if (!SamplingContext.Map.IsEmpty())
+		{
+			Record->Map = Record->AddText(SamplingContext.Map);
+		}
+		Result.Record = Record;
+		return Result;
+	}
+	sentry_transaction_context_t* Context = sentry_transaction_context_new(TCHAR_TO_UTF8(*Name), TCHAR_TO_UTF8(*Operation));
+	sentry_transaction_context_set_sampled(Context, 1);
+
+	FScopeLock Lock(&TracingLock);
+	Result.Transaction = sentry_transaction_start(Context, sentry_value_new_null());
+#endif
+	return Result;
+}
+
+FSentrySpan FSentryTransaction::StartChild(const FString& Operation, const FString& Description)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Transaction)
+	{
+		FScopeLock Lock(&TracingLock);
+		return FSentrySpan(sentry_transaction_start_child(Transaction, TCHAR_TO_UTF8(*Operation), TCHAR_TO_UTF8(*Description)));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		const int32 Index = StartRecordSpan(Record, 0, Operation, Description);
+		if (Index != INDEX_NONE)
+		{
+			return FSentrySpan(Record, Index);
+		}
+	}
+#endif
+	return FSentrySpan();
+}
+
+void FSentryTransaction::SetTag(const FString& Key, const FString& Value)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Transaction)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_transaction_set_tag(Transaction, TCHAR_TO_UTF8(*Key), TCHAR_TO_UTF8(*Value));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		SetRecordTag(Record, 0, Key, Value);
+	}
+#endif
+}
+
+void FSentryTransaction::SetData(const FString& Key, const FString& Value)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Transaction)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_transaction_set_data(Transaction, TCHAR_TO_UTF8(*Key), sentry_value_new_string(TCHAR_TO_UTF8(*Value)));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		SetRecordData(Record, 0, Key, &Value, 0.0);
+	}
+#endif
+}
+
+void FSentryTransaction::SetData(const FString& Key, double Value)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Transaction)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_transaction_set_data(Transaction, TCHAR_TO_UTF8(*Key), sentry_value_new_double(Value));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		SetRecordData(Record, 0, Key, nullptr, Value);
+	}
+#endif
+}
+
+void FSentryTransaction::SetStatus(ESentrySpanStatus Status)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Transaction)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_transaction_set_status(Transaction, ToSentry(Status));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		SetRecordStatus(Record, 0, Status);
+	}
+#endif
+}
+
+void FSentryTransaction::MakeCurrent()
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Transaction)
+	{
+		FScopeLock Lock(&TracingLock);
+		CurrentTransaction = Transaction;
+		CurrentRecord = nullptr;
+		sentry_set_transaction_object(Transaction);
+		GSentryTracingActive = true;
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		CurrentRecord = Record;
+		CurrentTransaction = nullptr;
+		GSentryTracingActive = true;
+
+		// link events to the transaction
+		sentry_value_t trace = sentry_value_new_object();
+		sentry_value_set_by_key(trace, "type", sentry_value_new_string("trace"));
+		sentry_value_set_by_key(trace, "trace_id", sentry_value_new_string(TCHAR_TO_UTF8(*Record->TraceId.ToString(EGuidFormats::Digits).ToLower())));
+		sentry_value_set_by_key(trace, "span_id", sentry_value_new_string(TCHAR_TO_UTF8(*Record->GetSpanId(0))));
+		sentry_value_set_by_key(trace, "op", sentry_value_new_string(Record->GetText(Record->Spans[0].Operation)));
+		sentry_set_context("trace", trace);
+	}
+#endif
+}
+
+void FSentryTransaction::Finish()
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Transaction)
+	{
+		FScopeLock Lock(&TracingLock);
+		if (CurrentTransaction == Transaction)
+		{
+			CurrentTransaction = nullptr;
+			GSentryTracingActive = false;
+		}
+		// also removes it from the scope
+		sentry_transaction_finish(Transaction);
+		Transaction = nullptr;
+	}
+	if (Record)
+	{
+		{
+			FScopeLock Lock(&TracingLock);
+			if (CurrentRecord == Record)
+			{
+				CurrentRecord = nullptr;
+				GSentryTracingActive = false;
+				sentry_remove_context("trace");
+			}
+			Record->Spans[0].EndTime = FPlatformTime::Seconds();
+			Record->bFinished = true;
+		}
+		// a finished transaction is not modified any more, it can be read without the lock
+		FSentrySpanRecorder::Submit(*Record);
+
+		FScopeLock Lock(&TracingLock);
+		ReleaseRecord(Record);
+		Record = nullptr;
+	}
+#endif
+}
+
+void FSentryTransaction::Discard()
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Transaction)
+	{
+		SetStatus(ESentrySpanStatus::Cancelled);
+		Finish();
+	}
+	if (Record)
+	{
+		{
+			FScopeLock Lock(&TracingLock);
+			if (CurrentRecord == Record)
+			{
+				CurrentRecord = nullptr;
+				GSentryTracingActive = false;
+				sentry_remove_context("trace");
+			}
+			Record->bFinished = true;
+		}
+		FSentrySpanRecorder::Discard(*Record);
+
+		FScopeLock Lock(&TracingLock);
+		ReleaseRecord(Record);
+		Record = nullptr;
+	}
+#endif
+}
+
+FSentrySpan::FSentrySpan(FSentrySpan&& Other)
+	: Span(Other.Span)
+	, Record(Other.Record)
+	, RecordIndex(Other.RecordIndex)
+{
+	Other.Span = nullptr;
+	Other.Record = nullptr;
+}
+
+FSentrySpan& FSentrySpan::operator=(FSentrySpan&& Other)
+{
+	if (this != &Other)
+	{
+		Finish();
+		Span = Other.Span;
+		Record = Other.Record;
+		RecordIndex = Other.RecordIndex;
+		Other.Span = nullptr;
+		Other.Record = nullptr;
+	}
+	return *this;
+}
+
+FSentrySpan::~FSentrySpan()
+{
+	Finish();
+}
+
+FSentrySpan FSentrySpan::StartChild(const FString& Operation, const FString& Description)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Span)
+	{
+		FScopeLock Lock(&TracingLock);
+		return FSentrySpan(sentry_span_start_child(Span, TCHAR_TO_UTF8(*Operation), TCHAR_TO_UTF8(*Description)));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		const int32 Index = StartRecordSpan(Record, RecordIndex, Operation, Description);
+		if (Index != INDEX_NONE)
+		{
+			return FSentrySpan(Record, Index);
+		}
+	}
+#endif
+	return FSentrySpan();
+}
+
+void FSentrySpan::SetTag(const FString& Key, const FString& Value)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Span)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_span_set_tag(Span, TCHAR_TO_UTF8(*Key), TCHAR_TO_UTF8(*Value));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		SetRecordTag(Record, RecordIndex, Key, Value);
+	}
+#endif
+}
+
+void FSentrySpan::SetData(const FString& Key, const FString& Value)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Span)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_span_set_data(Span, TCHAR_TO_UTF8(*Key), sentry_value_new_string(TCHAR_TO_UTF8(*Value)));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		SetRecordData(Record, RecordIndex, Key, &Value, 0.0);
+	}
+#endif
+}
+
+void FSentrySpan::SetData(const FString& Key, double Value)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Span)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_span_set_data(Span, TCHAR_TO_UTF8(*Key), sentry_value_new_double(Value));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		SetRecordData(Record, RecordIndex, Key, nullptr, Value);
+	}
+#endif
+}
+
+void FSentrySpan::SetStatus(ESentrySpanStatus Status)
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Span)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_span_set_status(Span, ToSentry(Status));
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		SetRecordStatus(Record, RecordIndex, Status);
+	}
+#endif
+}
+
+void FSentrySpan::GetTraceHeaders(TArray<TPair<FString, FString>>& OutHeaders) const
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Span)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_span_iter_headers(Span, [](const char* Key, const char* Value, void* UserData)
+			{
+				((TArray<TPair<FString, FString>>*)UserData)->Emplace(UTF8_TO_TCHAR(Key), UTF8_TO_TCHAR(Value));
+			}, &OutHeaders);
+	}
+	if (Record)
+	{
+		// recorded transactions are always sampled, they are only dropped by the tail sampler
+		FScopeLock Lock(&TracingLock);
+		const FString TraceId = Record->TraceId.ToString(EGuidFormats::Digits).ToLower();
+		OutHeaders.Emplace(TEXT("sentry-trace"), FString::Printf(TEXT("%s-%s-1"), *TraceId, *Record->GetSpanId(RecordIndex)));
+		OutHeaders.Emplace(TEXT("baggage"), FSentrySpanRecorder::GetBaggage(*Record));
+	}
+#endif
+}
+
+void FSentrySpan::Finish()
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Span)
+	{
+		FScopeLock Lock(&TracingLock);
+		sentry_span_finish(Span);
+		Span = nullptr;
+	}
+	if (Record)
+	{
+		FScopeLock Lock(&TracingLock);
+		FinishRecordSpan(Record, RecordIndex);
+		Record = nullptr;
+	}
+#endif
+}
+
+void FSentrySpan::Discard()
+{
+#if SENTRY_HAVE_PLATFORM
+	if (Span)
+	{
+		SetStatus(ESentrySpanStatus::Cancelled);
+		Finish();
+	}
+	if (Record)
+	{
+		// without an end time, the span is dropped when the transaction is sent
+		FScopeLock Lock(&TracingLock);
+		ReleaseRecord(Record);
+		Record = nullptr;
+	}
+#endif
+}
+
+
+void FSentrySpanScope::Begin(const ANSICHAR* Operation, const ANSICHAR* Description)
+{
+#if SENTRY_HAVE_PLATFORM
+	FScopeLock Lock(&TracingLock);
+	if (CurrentScope && CurrentScope->Record)
+	{
+		RecordIndex = StartRecordSpan(CurrentScope->Record, CurrentScope->RecordIndex, Operation, Description);
+		Record = RecordIndex != INDEX_NONE ? CurrentScope->Record : nullptr;
+	}
+	else if (CurrentScope)
+	{
+		Span = sentry_span_start_child(CurrentScope->Span, Operation, Description);
+	}
+	else if (CurrentRecord)
+	{
+		RecordIndex = StartRecordSpan(CurrentRecord, 0, Operation, Description);
+		Record = RecordIndex != INDEX_NONE ? CurrentRecord : nullptr;
+	}
+	else if (CurrentTransaction)
+	{
+		Span = sentry_transaction_start_child(CurrentTransaction, Operation, Description);
+	}
+	if (Span || Record)
+	{
+		Parent = CurrentScope;
+		CurrentScope = this;
+	}
+#endif
+}
+
+void FSentrySpanScope::End()
+{
+#if SENTRY_HAVE_PLATFORM
+	FScopeLock Lock(&TracingLock);
+	if (Record)
+	{
+		FinishRecordSpan(Record, RecordIndex);
+		Record = nullptr;
+	}
+	else
+	{
+		sentry_span_finish(Span);
+		Span = nullptr;
+	}
+	CurrentScope = Parent;
+#endif
+}
@@ -6,11 +6,12 @@
 #include "Misc/ScopeLock.h"
 #include "HAL/PlatformProcess.h"
 #include "HAL/PlatformTime.h"
+#include "Misc/DateTime.h"
 
 
 #if SENTRY_HAVE_PLATFORM
 
-sentry_transport_t* FSentryTransport::New() {
+sentry_transport_t* FSentryTransport::New(TSharedPtr<FSentryTransport, ESPMode::ThreadSafe>& OutTransport) {
 	sentry_transport_t* transport;
 
 	auto Self = MakeShared<FSentryTransport, ESPMode::ThreadSafe>();
@@ -29,9 +30,28 @@ sentry_transport_t* FSentryTransport::New() {
 	sentry_transport_set_shutdown_func(transport, _shutdown_func);
 	sentry_transport_set_free_func(transport, _free_func);
 	
+	OutTransport = Self;
 	return transport;
 }
 
+void FSentryTransport::Warmup()
+{
+	check(IsInGameThread());
+	// make sure the module is loaded before anyone calls us from another thread
+	FHttpModule::Get();
+
+	TArray<TArray<uint8>> ToSend;
+	{
+		FScopeLock Lock(&CriticalSection);
+		bWarm = true;
+		ToSend = MoveTemp(Queued);
+	}
+	for (auto& Content : ToSend)
+	{
+		PostContent(Content);
+	}
+}
+
 
 void FSentryTransport::ParseDSN(const FString &dsn)
 {
@@ -73,8 +93,99 @@ void FSentryTransport::send_func(sentry_envelope_t* envelope)
 {
 	if (!Started)
 	{
+		sentry_envelope_free(envelope);
 		return;
 	}
+
+	// set the content, content-length handled automatically
+	size_t outsize;
+	ANSICHAR* data = sentry_envelope_serialize(envelope, &outsize);
+	TArray<uint8> content((uint8*)data, outsize);
+	sentry_string_free(data);
+	sentry_envelope_free(envelope);
+	SendContent(MoveTemp(content));
+}
+
+void FSentryTransport::SendContent(TArray<uint8>&& Content)
+{
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (!bWarm)
+		{
+			if (Queued.Num() < MaxQueued)
+			{
+				Queued.Add(MoveTemp(Content));
+			}
+			return;
+		}
+	}
+	PostContent(Content);
+}
+
+FSentryEnvelopeItem FSentryEnvelopeItem::FromValue(const FString& Type, sentry_value_t Value)
+{
+	char* json = sentry_value_to_json(Value);
+	sentry_value_decref(Value);
+
+	FSentryEnvelopeItem Item;
+	Item.Type = Type;
+	Item.Payload.Append((const uint8*)json, FCStringAnsi::Strlen(json));
+	sentry_string_free(json);
+	return Item;
+}
+
+void FSentryTransport::SendEnvelope(const FString& EventId, TArray<FSentryEnvelopeItem>&& Items)
+{
+	// sentry drops everything when consent is required and not given
+	if (bConsentRequired && sentry_user_consent_get() != SENTRY_USER_CONSENT_GIVEN)
+	{
+		return;
+	}
+
+	// the headers are built as values, which takes care of escaping
+	auto AppendLine = [](TArray<uint8>& Content, sentry_value_t Value)
+	{
+		char* json = sentry_value_to_json(Value);
+		sentry_value_decref(Value);
+		Content.Append((const uint8*)json, FCStringAnsi::Strlen(json));
+		Content.Add('\n');
+		sentry_string_free(json);
+	};
+
+	sentry_value_t header = sentry_value_new_object();
+	if (!EventId.IsEmpty())
+	{
+		sentry_value_set_by_key(header, "event_id", sentry_value_new_string(TCHAR_TO_UTF8(*EventId)));
+	}
+	sentry_value_set_by_key(header, "dsn", sentry_value_new_string(TCHAR_TO_UTF8(*Dsn)));
+	sentry_value_set_by_key(header, "sent_at", sentry_value_new_string(TCHAR_TO_UTF8(*FDateTime::UtcNow().ToIso8601())));
+
+	int32 Size = 256;
+	for (const FSentryEnvelopeItem& Item : Items)
+	{
+		Size += Item.Payload.Num() + 128;
+	}
+	TArray<uint8> Content;
+	Content.Reserve(Size);
+	AppendLine(Content, header);
+	for (const FSentryEnvelopeItem& Item : Items)
+	{
+		sentry_value_t item_header = sentry_value_new_object();
+		sentry_value_set_by_key(item_header, "type", sentry_value_new_string(TCHAR_TO_UTF8(*Item.Type)));
+		sentry_value_set_by_key(item_header, "length", sentry_value_new_int32((int32_t)Item.Payload.Num()));
+		for (const auto& Header : Item.Headers)
+		{
+			sentry_value_set_by_key(item_header, TCHAR_TO_UTF8(*Header.Key), sentry_value_new_string(TCHAR_TO_UTF8(*Header.Value)));
+		}
+		AppendLine(Content, item_header);
+		Content.Append(Item.Payload);
+		Content.Add('\n');
+	}
+	SendContent(MoveTemp(Content));
+}
+
+void FSentryTransport::PostContent(const TArray<uint8>& Content)
+{
 	auto HttpRequest = FHttpModule::Get().CreateRequest();
 	HttpRequest->SetURL(sentry_url);
 	HttpRequest->SetVerb(TEXT("POST"));
@@ -94,14 +205,7 @@ void FSentryTransport::send_func(sentry_envelope_t* envelope)
 	// Override the user agent, putting the client in here
 	HttpRequest->SetHeader(TEXT("UserAgent"), TEXT(SENTRY_PLUGIN_NAME) TEXT(" For UE4"));
 
-
-	// set the content, content-length handled automatically
-	size_t outsize;
-	ANSICHAR* data = sentry_envelope_serialize(envelope, &outsize);
-	TArray<uint8> content((uint8*)data, outsize);
-	sentry_string_free(data);
-	sentry_envelope_free(envelope);
-	HttpRequest->SetContent(content);
+	HttpRequest->SetContent(Content);
 
 	HttpRequest->OnProcessRequestComplete().BindThreadSafeSP(this, &FSentryTransport::OnComplete);
 	// we can ba called on any thread, so guard this
@@ -120,6 +224,8 @@ int FSentryTransport::startup_func(const sentry_options_t* options)
 {
 	FString dsn = ANSI_TO_TCHAR(sentry_options_get_dsn(options));
 	ParseDSN(dsn);
+	Dsn = dsn;
+	bConsentRequired = sentry_options_get_require_user_consent(options) != 0;
 	Started = true;
 	return 0;
 }
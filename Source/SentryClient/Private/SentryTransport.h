@@ -8,17 +8,42 @@
 
 #if SENTRY_HAVE_PLATFORM
 
+// An item of an envelope which the plugin builds itself, see https://develop.sentry.dev/sdk/envelopes/
+struct FSentryEnvelopeItem
+{
+	// the item type, e.g. "transaction" or "attachment"
+	FString Type;
+	// more item headers, e.g. the filename of an attachment
+	TMap<FString, FString> Headers;
+	TArray<uint8> Payload;
+
+	// An item holding the value as json.  Takes ownership of the value.
+	static FSentryEnvelopeItem FromValue(const FString& Type, sentry_value_t Value);
+};
+
 class FSentryTransport : public TSharedFromThis<FSentryTransport, ESPMode::ThreadSafe>
 {
 public:
 	
-	// create a new transport
-	static sentry_transport_t* New();
+	// create a new transport.  Envelopes are queued until Warmup() has been called,
+	// so that the transport can be created before the http module is available.
+	static sentry_transport_t* New(TSharedPtr<FSentryTransport, ESPMode::ThreadSafe>& OutTransport);
 	~FSentryTransport()
 	{
 		;
 	}
 
+	// Load the http module and send any queued envelopes.  Call on the game thread.
+	void Warmup();
+
+	// post a serialized envelope, or queue it if we are not warmed up yet.  Thread safe.
+	void SendContent(TArray<uint8>&& Content);
+
+	// Frame the items as an envelope, with the event id if not empty, the dsn and the time
+	// in its header, and send it.  Dropped when consent is required and not given, like
+	// sentry does with its own envelopes.  Thread safe.
+	void SendEnvelope(const FString& EventId, TArray<FSentryEnvelopeItem>&& Items);
+
 private:
 	// the transport api hook functions, thunkers and members
 	static void _send_func(sentry_envelope_t* envelope, void* state)
@@ -52,6 +77,8 @@ private:
 	
 	void ParseDSN(const FString& dsn);
 
+	void PostContent(const TArray<uint8>& Content);
+
 	/**
 	 * Callback from the HttpRequest.
 	 * Called when an Http request completes.
@@ -61,6 +88,10 @@ private:
 	// todo: Support some sort of rate limiting
 	float maxRate = 0.0;
 
+	// from the options, for the envelopes built by the plugin
+	FString Dsn;
+	bool bConsentRequired = false;
+
 	// these are computed from the dsn
 	FString sentry_url;
 	FString sentry_key;
@@ -77,6 +108,11 @@ private:
 
 	// is this transport started or stopped
 	bool Started = false;
+
+	// envelopes sent before Warmup().  We don't keep more than a few.
+	static constexpr int32 MaxQueued = 32;
+	TArray<TArray<uint8>> Queued;
+	bool bWarm = false;
 };
 
 #endif
@@ -3,6 +3,7 @@
 #include "Kismet/BlueprintFunctionLibrary.h"
 
 #include "SentryCore.h"
+#include "SentryTracing.h"
 
 #include "BlueprintLib.generated.h"
 
@@ -156,6 +157,91 @@ private:
 };
 
 
+/**
+ * A performance span, see https://docs.sentry.io/product/performance/
+ */
+UCLASS(BlueprintType)
+class SENTRYCLIENT_API USentrySpan : public UObject
+{
+	GENERATED_BODY()
+public:
+	/**
+	 * Start a child span of this span
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	USentrySpan* StartChild(const FString& Operation, const FString& Description);
+
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	void SetTag(const FString& Key, const FString& Value);
+
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	void SetData(const FString& Key, const FString& Value);
+
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	void SetStatus(ESentrySpanStatus Status);
+
+	/**
+	 * Finish the span.  It is sent with its transaction.  A span which is not finished
+	 * when the object is garbage collected is discarded.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	void Finish();
+
+	virtual void BeginDestroy() override;
+
+	FSentrySpan Span;
+};
+
+/**
+ * A performance transaction, see https://docs.sentry.io/product/performance/
+ * Transactions which are not recorded, because tracing is disabled or they are sampled out,
+ * can be used as usual but do nothing.
+ */
+UCLASS(BlueprintType)
+class SENTRYCLIENT_API USentryTransaction : public UObject
+{
+	GENERATED_BODY()
+public:
+	/**
+	 * Is the transaction being recorded?
+	 */
+	UFUNCTION(BlueprintPure, Category = "Sentry|Tracing")
+	bool IsRecording() const;
+
+	/**
+	 * Start a span in this transaction
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	USentrySpan* StartChild(const FString& Operation, const FString& Description);
+
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	void SetTag(const FString& Key, const FString& Value);
+
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	void SetData(const FString& Key, const FString& Value);
+
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	void SetStatus(ESentrySpanStatus Status);
+
+	/**
+	 * Make this the parent of spans measured in C++ (SENTRY_SPAN), and link events to it
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	void MakeCurrent();
+
+	/**
+	 * Finish and send the transaction.  A transaction which is not finished when the object
+	 * is garbage collected is discarded, it would have the duration up to the collection.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	void Finish();
+
+	virtual void BeginDestroy() override;
+
+	FSentryTransaction Transaction;
+};
+
+
 UCLASS()
 class SENTRYCLIENT_API USentryBlueprintLibrary : public UBlueprintFunctionLibrary
 {
@@ -203,6 +289,22 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Sentry|Consent")
 	static void SetUserConsent(ESentryConsent Consent);
 
+
+	// Release health
+	/**
+	 * End the current session and start a new one, e.g. at the start of a play session.
+	 * A session is started automatically at init when SessionTracking is on.
+	 * See https://docs.sentry.io/product/releases/health/
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Session")
+	static void StartSession();
+
+	/**
+	 * End the current session, as exited normally
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Session")
+	static void EndSession();
+
 	
 	// User information
 	/**
@@ -297,4 +399,11 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Sentry|UserFeedback")
 	static void SubmitUserFeedback(const FString& Name, const FString& EventMessage, const FString& Comments);
 
+	/**
+	 * Start a performance transaction.  Finish it to send it.
+	 * See https://docs.sentry.io/product/performance/
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Sentry|Tracing")
+	static USentryTransaction* StartTransaction(const FString& Name, const FString& Operation);
+
 };
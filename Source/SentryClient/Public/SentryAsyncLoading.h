@@ -0,0 +1,17 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/UObjectGlobals.h"
+
+// Latency of async package loads, see the README.  Enabled with AsyncLoadTracking,
+// otherwise these only load.
+class SENTRYCLIENT_API FSentryAsyncLoading
+{
+public:
+	// ::LoadPackageAsync, recording how long the load took
+	static int32 LoadPackageAsync(const FString& Name, FLoadPackageAsyncDelegate CompletionDelegate = FLoadPackageAsyncDelegate(),
+		TAsyncLoadPriority Priority = 0);
+
+	// Record a load measured by the game, e.g. of a FStreamableManager request.  Thread safe.
+	static void RecordLoad(const FString& Package, double Seconds);
+};
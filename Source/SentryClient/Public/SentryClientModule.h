@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
 #include "Misc/OutputDeviceError.h"
+#include "Async/Future.h"
 
 #include "SentryClientModule.generated.h"
 
@@ -16,6 +17,25 @@ DECLARE_LOG_CATEGORY_EXTERN(LogSentryCore, Verbose, All);
 #define SENTRY_PLUGIN_NAME "SentryClient"
 
 class FSentryClientModule;
+class FSentryHangWatchdog;
+class FSentryTransport;
+class FSentryCrashLoop;
+class FSentryEnsureReporter;
+class FSentryJournal;
+class FSentryMemoryWatch;
+class FSentryMemoryTrend;
+class FSentryDatabasePruner;
+class FSentryBreadcrumbQueue;
+class FSentryLevelLoadTracker;
+class FSentryFrameStats;
+class FSentryServerHealth;
+class FSentryGCTracker;
+class FSentryAsyncLoadTracker;
+class FSentryTraceSnapshot;
+class FSentrySpanRecorder;
+class FSentryStatBridge;
+class FSentrySessionAggregator;
+class UWorld;
 
 // Class for binding to the GLog and funneling messages .
 class FSentryOutputDevice : public FOutputDevice
@@ -86,18 +106,73 @@ public:
 	bool IsInitialized() const { return initialized; }
 
 	static void SentryLog(int level, const char* message, va_list args);
-	static sentry_value_t SentryCrash(const sentry_ucontext_t* uctx, sentry_value_t event);
+	sentry_value_t SentryCrash(const sentry_ucontext_t* uctx, sentry_value_t event);
 
 	ELogVerbosity::Type GetVerbosity() const { return Verbosity; }
 	void SetVerbosity(ELogVerbosity::Type _Verbosity) { Verbosity = _Verbosity; }
 
+	// Log output of a failed ensure, called on the failing thread
+	bool IsCapturingEnsures() const { return EnsureReporter.IsValid(); }
+	void CaptureEnsure(const TCHAR* Msg);
+
 private:
+	// Initialization happens in two stages.  The first only sets up the sdk and
+	// the crash backend, and is run as early as possible.  The second adds context,
+	// user and tags and starts the optional features once the engine is up.
+	bool InitBackend(const TCHAR* DSN, const TCHAR* Environment, const TCHAR* Release, bool IsConsentRequired);
+	void CompleteInit();
+	void OnPostEngineInit();
+
+	// start and stop the optional helpers which run alongside the sdk
+	void StartFeatures();
+	void StopFeatures();
+
+	// called on the game thread at the end of every frame
+	void OnEndFrame();
+	void OnPostLoadMap(UWorld* World);
+
 	bool initialized = false;
 	FString dbPath;
+	// as passed to the sdk, for what we send ourselves
+	FString ReleaseName;
+	FString EnvironmentName;
+	bool bConsentRequired = false;
+	// dedicated server counting player sessions, see FSentrySessionAggregator
+	bool bSessionAggregates = false;
 	FString CrashPadLocation;
 	TSharedPtr<FSentryOutputDevice> LogDevice;
 	ELogVerbosity::Type Verbosity = ELogVerbosity::Warning;  // only report warnings or worse as breadcrumbs
 	static FSentryErrorOutputDevice ErrorDevice;
+
+#if SENTRY_HAVE_PLATFORM
+	TSharedPtr<FSentryTransport, ESPMode::ThreadSafe> Transport;
+#endif
+	FDelegateHandle PostEngineInitHandle;
+	TFuture<void> ContextTask;
+	double InitStartTime = 0.0;
+	double BackendInitTime = 0.0;
+
+	TUniquePtr<FSentryCrashLoop> CrashLoop;
+	TUniquePtr<FSentryHangWatchdog> HangWatchdog;
+	TUniquePtr<FSentryEnsureReporter> EnsureReporter;
+	TUniquePtr<FSentryJournal> Journal;
+	TUniquePtr<FSentryMemoryWatch> MemoryWatch;
+	TUniquePtr<FSentryMemoryTrend> MemoryTrend;
+	TUniquePtr<FSentryDatabasePruner> DatabasePruner;
+	TUniquePtr<FSentryBreadcrumbQueue> BreadcrumbQueue;
+	TUniquePtr<FSentryLevelLoadTracker> LevelLoadTracker;
+	TUniquePtr<FSentryFrameStats> FrameStats;
+	TUniquePtr<FSentryServerHealth> ServerHealth;
+	TUniquePtr<FSentryGCTracker> GCTracker;
+	TUniquePtr<FSentryAsyncLoadTracker> AsyncLoadTracker;
+	TUniquePtr<FSentryTraceSnapshot> TraceSnapshot;
+	TUniquePtr<FSentrySpanRecorder> SpanRecorder;
+#if STATS
+	TUniquePtr<FSentryStatBridge> StatBridge;
+#endif
+	TUniquePtr<FSentrySessionAggregator> SessionAggregator;
+	FDelegateHandle EndFrameHandle;
+	FDelegateHandle PostLoadMapHandle;
 };
 
 
@@ -140,10 +215,263 @@ public:
 	UPROPERTY(Config);
 	FString Tags;	// comma separated list of key=value tags
 
+	// Fraction of performance transactions which are recorded (0 disables tracing)
+	UPROPERTY(Config);
+	float TracesSampleRate = 0.0f;
+
+	// Largest number of spans recorded in a transaction
+	UPROPERTY(Config);
+	int32 MaxSpans = 1000;
+
+	// Record transactions in the plugin's compact records instead of sentry-native, see the README
+	UPROPERTY(Config);
+	bool RecordTransactions = false;
+
+	// Record transactions locally, and only send those which are slow or end with an error (implies RecordTransactions)
+	UPROPERTY(Config);
+	bool TailSampling = false;
+
+	// Milliseconds above which a transaction is sent, with tail sampling
+	UPROPERTY(Config);
+	float TailSampleThreshold = 1000.0f;
+
+	// Thresholds per operation, as comma separated op=milliseconds pairs, e.g. "level.load=5000,http.client=500"
+	UPROPERTY(Config);
+	FString TailSampleThresholds;
+
+	// Seconds between two reports of the transaction durations, with tail sampling
+	UPROPERTY(Config);
+	float TailSampleReportInterval = 300.0f;
+
+	// Comma separated short names of stats (e.g. STAT_UpdateLevelStreaming) which are added as
+	// spans to the current transaction when they take longer than StatSpanThreshold in a frame
+	UPROPERTY(Config);
+	FString StatSpans;
+
+	// Milliseconds per frame above which one of the StatSpans is added
+	UPROPERTY(Config);
+	float StatSpanThreshold = 5.0f;
+
+	// Record map loads and seamless travel as transactions, when tracing is enabled
+	UPROPERTY(Config);
+	bool TraceLevelLoads = true;
+
+	// Comma separated parts of urls which FSentryHttp::ProcessRequest sends trace headers to, none if empty
+	UPROPERTY(Config);
+	FString TracePropagationTargets;
+
+	// Fraction of the recorded transactions which are profiled, Linux only (0 disables profiling)
+	UPROPERTY(Config);
+	float ProfilesSampleRate = 0.0f;
+
+	// Samples per second of the game thread stack, while a profiled transaction runs
+	UPROPERTY(Config);
+	float ProfilingFrequency = 100.0f;
+
+	// Seconds of samples kept, a longer transaction is sent with the end of its profile
+	UPROPERTY(Config);
+	float ProfilingMaxDuration = 30.0f;
+
+	// Periodically send frame time percentiles and the number of hitches
+	UPROPERTY(Config);
+	bool FrameStats = false;
+
+	// Seconds between two frame time reports
+	UPROPERTY(Config);
+	float FrameStatsInterval = 300.0f;
+
+	// Frames longer than this many milliseconds are counted as hitches
+	UPROPERTY(Config);
+	float FrameHitchThreshold = 100.0f;
+
+	// On dedicated servers, periodically send tick rate reports and warn when the tick rate degrades
+	UPROPERTY(Config);
+	bool ServerHealth = false;
+
+	// Seconds between two server tick reports
+	UPROPERTY(Config);
+	float ServerHealthInterval = 300.0f;
+
+	// Ticks per second the server should reach, 0 for the engine's NetServerMaxTickRate
+	UPROPERTY(Config);
+	float ServerTargetTickRate = 0.0f;
+
+	// A warning is sent when the tick rate stays below this percentage of the target...
+	UPROPERTY(Config);
+	float ServerDegradedPercent = 80.0f;
+
+	// ...for this many seconds
+	UPROPERTY(Config);
+	float ServerDegradedSeconds = 10.0f;
+
+	// Measure garbage collection pauses, and report long ones
+	UPROPERTY(Config);
+	bool GCTracking = false;
+
+	// Milliseconds above which a garbage collection pause is reported
+	UPROPERTY(Config);
+	float GCPauseThreshold = 50.0f;
+
+	// Minimum seconds between two long garbage collection reports
+	UPROPERTY(Config);
+	float GCCooldown = 300.0f;
+
+	// Record the load times of packages loaded with FSentryAsyncLoading
+	UPROPERTY(Config);
+	bool AsyncLoadTracking = false;
+
+	// Milliseconds above which an async load is a span of the current transaction
+	UPROPERTY(Config);
+	float AsyncLoadThreshold = 100.0f;
+
+	// Seconds between two async load reports
+	UPROPERTY(Config);
+	float AsyncLoadReportInterval = 300.0f;
+
+	// Attach an Unreal Insights snapshot of the trace buffer to an event on a severe hitch or a long transaction (UE 5.1+)
+	UPROPERTY(Config);
+	bool TraceSnapshots = false;
+
+	// Frames longer than this many milliseconds take a trace snapshot
+	UPROPERTY(Config);
+	float TraceSnapshotHitchThreshold = 1000.0f;
+
+	// Recorded transactions longer than this many milliseconds take a trace snapshot (0 disables)
+	UPROPERTY(Config);
+	float TraceSnapshotTransactionThreshold = 0.0f;
+
+	// Megabytes above which a trace snapshot is not sent
+	UPROPERTY(Config);
+	float TraceSnapshotMaxSize = 32.0f;
+
+	// Largest number of trace snapshots taken in a run
+	UPROPERTY(Config);
+	int32 TraceSnapshotsPerSession = 1;
+
+	// Seconds between two trace snapshots
+	UPROPERTY(Config);
+	float TraceSnapshotCooldown = 600.0f;
+
+	// Milliseconds between passing batches of log breadcrumbs to sentry (0 to pass each one immediately)
+	UPROPERTY(Config);
+	int32 BreadcrumbFlushInterval = 0;
+
+	// Release health: a session per run of the game, see https://docs.sentry.io/product/releases/health/
+	UPROPERTY(Config);
+	bool SessionTracking = true;
+
+	// On dedicated servers, count a session per connected player and send them as per minute aggregates
+	UPROPERTY(Config);
+	bool ServerSessionAggregates = false;
+
+	// Database folder, or a ';' separated list of folders to try in order (default is Saved/sentry-native)
+	UPROPERTY(Config);
+	FString DatabasePath;
+
+	// Size limit of the database folder in megabytes, oldest reports are removed first (0 for no limit)
+	UPROPERTY(Config);
+	int32 DatabaseMaxSizeMB = 0;
+
+	// Reports older than this many days are removed from the database (0 for no limit)
+	UPROPERTY(Config);
+	float DatabaseMaxAgeDays = 0.0f;
+
+	// Seconds between two prunes of the database
+	UPROPERTY(Config);
+	float DatabasePruneInterval = 600.0f;
+
+	// Number of crashes within CrashLoopWindow seconds which are considered a crash loop (0 to disable)
+	UPROPERTY(Config);
+	int32 CrashLoopThreshold = 0;
+
+	UPROPERTY(Config);
+	float CrashLoopWindow = 600.0f;
+
+	// Seconds of uptime after which the crash history is cleared
+	UPROPERTY(Config);
+	float CrashLoopRecoveryTime = 600.0f;
+
+	// Fraction of crashes reported while in a crash loop
+	UPROPERTY(Config);
+	float CrashLoopSampleRate = 0.1f;
+
+	// Report game thread stalls as "App Hanging" events
+	UPROPERTY(Config);
+	bool HangDetection = false;
+
+	// Seconds without a game thread frame before a stall is reported
+	UPROPERTY(Config);
+	float HangThreshold = 5.0f;
+
+	// Minimum seconds between two hang reports
+	UPROPERTY(Config);
+	float HangCooldown = 300.0f;
+
+	// Don't consider blocking map loads as hangs
+	UPROPERTY(Config);
+	bool HangIgnoreMapLoad = true;
+
+	// Report failed ensure() conditions as events
+	UPROPERTY(Config);
+	bool CaptureEnsures = false;
+
+	// Resolve function names and lines of ensure callstacks locally, on the thread of the ensure
+	UPROPERTY(Config);
+	bool EnsureSymbolication = false;
+
+	// Report runs that ended without a crash report or an orderly shutdown (killed, power loss, ...)
+	UPROPERTY(Config);
+	bool AbnormalExitDetection = false;
+
+	// Number of breadcrumbs kept in the journal file for abnormal exit reports
+	UPROPERTY(Config);
+	int32 JournalRecords = 256;
+
+	// Report low memory conditions and out of memory failures
+	UPROPERTY(Config);
+	bool LowMemoryReporting = false;
+
+	// Megabytes reserved at startup and released when memory runs out, so that the report can be made
+	UPROPERTY(Config);
+	int32 EmergencyReserveMB = 16;
+
+	// A low memory event is sent when less physical memory than this is available (0 to only report OOM)
+	UPROPERTY(Config);
+	int32 LowMemoryThresholdMB = 256;
+
+	// Sample memory use on a background thread and report when it keeps growing
+	UPROPERTY(Config);
+	bool MemoryTrend = false;
+
+	// Seconds between two memory samples
+	UPROPERTY(Config);
+	float MemorySampleInterval = 10.0f;
+
+	// Seconds of samples the growth is measured over
+	UPROPERTY(Config);
+	float MemoryLeakWindow = 3600.0f;
+
+	// Growth of used physical memory, in megabytes per hour, above which a warning is sent
+	UPROPERTY(Config);
+	float MemoryLeakThreshold = 100.0f;
+
 	// return an environment or command line option.  Return true if found.
 	static bool GetEnvOrCmdLine(const TCHAR* name, FString &out);
 	static FString GetEnvOrCmdLine(const TCHAR* name);
 	static FString GetConfig(const TCHAR* name, const TCHAR *defaultval);
+	// typed versions of the above, defaultval usually being the .ini value
+	static bool GetConfigBool(const TCHAR* name, bool defaultval);
+	static int32 GetConfigInt(const TCHAR* name, int32 defaultval);
+	static float GetConfigFloat(const TCHAR* name, float defaultval);
+
+	// Read a key from the Sentry ini files directly.  Unlike Get(), this works
+	// during early startup, before the UObject system is initialized.
+	static bool GetIniValue(const TCHAR* key, FString& out);
+	// The value of a config property, from the config object if it is available, else from the ini files.
+	static FString GetSetting(const TCHAR* key, FString USentryClientConfig::* member);
+	static bool GetSetting(const TCHAR* key, bool USentryClientConfig::* member, bool defaultval);
+	static int32 GetSetting(const TCHAR* key, int32 USentryClientConfig::* member, int32 defaultval);
+	static float GetSetting(const TCHAR* key, float USentryClientConfig::* member, float defaultval);
 
 	static bool IsEnabled();
 	static bool ShouldDisable();
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IHttpRequest;
+
+// Tracing of http requests made with FHttpModule, see the README.
+class SENTRYCLIENT_API FSentryHttp
+{
+public:
+	// Process the request as a span of the current transaction, with trace headers so that
+	// the receiving service continues the trace.  Call this instead of Request->ProcessRequest(),
+	// after binding OnProcessRequestComplete().  Without a current transaction, the request
+	// is just processed.
+	static bool ProcessRequest(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& Request);
+};
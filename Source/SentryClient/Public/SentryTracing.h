@@ -0,0 +1,219 @@
+#pragma once
+
+#include "SentryCore.h"
+
+#include "CoreMinimal.h"
+
+#include <atomic>
+
+#include "SentryTracing.generated.h"
+
+// Performance monitoring: transactions and spans.
+// See https://docs.sentry.io/product/performance/
+//
+// Tracing is enabled with the TracesSampleRate setting.  A transaction which is
+// not enabled or sampled out is an empty handle, and all operations on it do nothing.
+//
+//	FSentryTransaction Load = FSentryTransaction::Start(TEXT("Load savegame"), TEXT("load"));
+//	Load.MakeCurrent();
+//	{
+//		SENTRY_SPAN("file.read", "savegame");
+//		...
+//	}
+//	Load.Finish();
+
+struct sentry_transaction_s;
+struct sentry_span_s;
+struct FSentryTransactionRecord;
+
+// Mirrors sentry_span_status_t
+UENUM(BlueprintType)
+enum class ESentrySpanStatus : uint8
+{
+	Ok = 0,
+	Cancelled,
+	Unknown,
+	InvalidArgument,
+	DeadlineExceeded,
+	NotFound,
+	AlreadyExists,
+	PermissionDenied,
+	ResourceExhausted,
+	FailedPrecondition,
+	Aborted,
+	OutOfRange,
+	Unimplemented,
+	InternalError,
+	Unavailable,
+	DataLoss,
+	Unauthenticated,
+};
+
+// What a traces sampler gets to decide on
+struct FSentrySamplingContext
+{
+	FString Name;
+	FString Operation;
+	// current map, if any
+	FString Map;
+	// ini platform name, e.g. Windows or Linux
+	FString Platform;
+	// id, or else user name, of the current user.  Empty if there is none.
+	FString UserId;
+	// the configured TracesSampleRate
+	float DefaultRate = 0.0f;
+};
+
+// Returns the sample rate (0-1) for a transaction.  Called on the thread starting the transaction.
+DECLARE_DELEGATE_RetVal_OneParam(float, FSentryTracesSampler, const FSentrySamplingContext&);
+
+// true while there is a current transaction for SENTRY_SPAN scopes to attach to
+extern SENTRYCLIENT_API std::atomic<bool> GSentryTracingActive;
+
+class FSentrySpan;
+
+// A transaction, finished when the handle is destroyed.  Operations are thread safe.
+class SENTRYCLIENT_API FSentryTransaction
+{
+public:
+	FSentryTransaction() = default;
+	FSentryTransaction(FSentryTransaction&& Other);
+	FSentryTransaction& operator=(FSentryTransaction&& Other);
+	~FSentryTransaction();
+
+	FSentryTransaction(const FSentryTransaction&) = delete;
+	FSentryTransaction& operator=(const FSentryTransaction&) = delete;
+
+	// Start a transaction.  Returns an empty handle if tracing is disabled or the transaction is sampled out.
+	static FSentryTransaction Start(const FString& Name, const FString& Operation);
+
+	// Fraction of transactions which are recorded, 0 disables tracing.  Set by the module at init.
+	static void SetSampleRate(float Rate);
+	static bool IsTracingEnabled();
+
+	// Decide the sample rate per transaction instead of using TracesSampleRate for all.
+	// Only consulted when tracing is enabled, i.e. TracesSampleRate is above 0.
+	// When the game has set a user id, the decision is a hash of it, so that a user's
+	// transactions are either all recorded or none are.
+	static void SetSampler(FSentryTracesSampler Sampler);
+
+	// The user and map passed to the sampler, kept up to date by the plugin.  The user is
+	// the id given to SetUser, empty if only a username was set.
+	static void SetSamplingUser(const FString& UserId);
+	static void SetSamplingMap(const FString& Map);
+
+	// Add a span which has already ended, lasting Duration seconds until now, to the current
+	// transaction, if there is one.  Sentry can't start spans in the past, so the duration
+	// and number of calls are also in the data of the span.
+	static void AddCurrentSpan(const FString& Operation, const FString& Description, double Duration, int32 Calls = 1);
+
+	// Start a span of the innermost SENTRY_SPAN scope on this thread, or else of the current
+	// transaction.  An empty handle if there is neither.
+	static FSentrySpan StartCurrentChild(const FString& Operation, const FString& Description);
+
+	bool IsValid() const { return Transaction != nullptr || Record != nullptr; }
+
+	FSentrySpan StartChild(const FString& Operation, const FString& Description);
+
+	void SetTag(const FString& Key, const FString& Value);
+	void SetData(const FString& Key, const FString& Value);
+	void SetData(const FString& Key, double Value);
+	void SetStatus(ESentrySpanStatus Status);
+
+	// Make this the parent of SENTRY_SPAN scopes, on any thread, and link events captured meanwhile to it
+	void MakeCurrent();
+
+	// Finish and send the transaction
+	void Finish();
+
+	// Give up on an unfinished transaction.  One recorded by the plugin is dropped with its spans.
+	// sentry-native can't drop a started transaction, it is sent with the cancelled status.
+	void Discard();
+
+private:
+	sentry_transaction_s* Transaction = nullptr;
+	// recorded by the plugin instead
+	FSentryTransactionRecord* Record = nullptr;
+};
+
+// A span, finished when the handle is destroyed.  Operations are thread safe.
+class SENTRYCLIENT_API FSentrySpan
+{
+public:
+	FSentrySpan() = default;
+	explicit FSentrySpan(sentry_span_s* InSpan) : Span(InSpan) {}
+	FSentrySpan(FSentrySpan&& Other);
+	FSentrySpan& operator=(FSentrySpan&& Other);
+	~FSentrySpan();
+
+	FSentrySpan(const FSentrySpan&) = delete;
+	FSentrySpan& operator=(const FSentrySpan&) = delete;
+
+	bool IsValid() const { return Span != nullptr || Record != nullptr; }
+
+	FSentrySpan StartChild(const FString& Operation, const FString& Description);
+
+	void SetTag(const FString& Key, const FString& Value);
+	void SetData(const FString& Key, const FString& Value);
+	void SetData(const FString& Key, double Value);
+	void SetStatus(ESentrySpanStatus Status);
+
+	// The headers continuing the trace at this span in another service, sentry-trace and baggage.
+	// See https://develop.sentry.dev/sdk/performance/#header-sentry-trace
+	void GetTraceHeaders(TArray<TPair<FString, FString>>& OutHeaders) const;
+
+	void Finish();
+
+	// Give up on an unfinished span.  A span of a transaction recorded by the plugin is left out
+	// of it, one of sentry-native is finished with the cancelled status.
+	void Discard();
+
+private:
+	friend class FSentryTransaction;
+	FSentrySpan(FSentryTransactionRecord* InRecord, int32 InRecordIndex) : Record(InRecord), RecordIndex(InRecordIndex) {}
+
+	sentry_span_s* Span = nullptr;
+	// a span of a locally recorded transaction, and its index in it
+	FSentryTransactionRecord* Record = nullptr;
+	int32 RecordIndex = INDEX_NONE;
+};
+
+// A span covering a C++ scope, see SENTRY_SPAN.  The parent is the innermost
+// enclosing scope on the same thread, or the current transaction.
+class FSentrySpanScope
+{
+public:
+	FSentrySpanScope(const ANSICHAR* Operation, const ANSICHAR* Description)
+	{
+		if (GSentryTracingActive.load(std::memory_order_relaxed))
+		{
+			Begin(Operation, Description);
+		}
+	}
+	~FSentrySpanScope()
+	{
+		if (Span || Record)
+		{
+			End();
+		}
+	}
+
+	FSentrySpanScope(const FSentrySpanScope&) = delete;
+	FSentrySpanScope& operator=(const FSentrySpanScope&) = delete;
+
+private:
+	SENTRYCLIENT_API void Begin(const ANSICHAR* Operation, const ANSICHAR* Description);
+	SENTRYCLIENT_API void End();
+
+	friend class FSentryTransaction;
+
+	sentry_span_s* Span = nullptr;
+	FSentryTransactionRecord* Record = nullptr;
+	int32 RecordIndex = INDEX_NONE;
+	FSentrySpanScope* Parent = nullptr;
+};
+
+// Measure the enclosing scope as a span of the current transaction:
+//	SENTRY_SPAN("db.query", "load inventory");
+// Without a current transaction this is a single test of a flag.
+#define SENTRY_SPAN(Operation, Description) FSentrySpanScope PREPROCESSOR_JOIN(SentrySpanScope, __LINE__)(Operation, Description)
@@ -79,6 +79,21 @@ public class SentryClient : ModuleRules
 			bUseCrashPad = true;
 		}
 
+		// On Linux the backend can be chosen at build time with the SENTRY_LINUX_BACKEND environment
+		// variable: "crashpad" (default), "breakpad" or "inproc".  The latter two run inside the game
+		// process, which saves the crashpad_handler process and its memory for every instance, but crashes
+		// are only uploaded on the next run.  The matching binaries are built by build_linux.sh.
+		string LinuxBackend = System.Environment.GetEnvironmentVariable("SENTRY_LINUX_BACKEND");
+		if (string.IsNullOrEmpty(LinuxBackend))
+		{
+			LinuxBackend = "crashpad";
+		}
+		LinuxBackend = LinuxBackend.ToLower();
+		if (Target.Platform == UnrealTargetPlatform.Linux)
+		{
+			bUseCrashPad = LinuxBackend == "crashpad";
+		}
+
 		if (!SentryDisable && bIsWindows)
 		{
 			SentryHavePlatform = true;
@@ -122,7 +137,22 @@ public class SentryClient : ModuleRules
 		else if (!SentryDisable && Target.Platform == UnrealTargetPlatform.Linux)
 		{
 			SentryHavePlatform = true;
-			SentryPlatform = Path.Combine(SentryRoot, "Linux");
+			if (LinuxBackend == "breakpad")
+			{
+				SentryPlatform = Path.Combine(SentryRoot, "Linux-Breakpad");
+			}
+			else if (LinuxBackend == "inproc")
+			{
+				SentryPlatform = Path.Combine(SentryRoot, "Linux-Inproc");
+			}
+			else if (LinuxBackend == "crashpad")
+			{
+				SentryPlatform = Path.Combine(SentryRoot, "Linux");
+			}
+			else
+			{
+				throw new BuildException("Unknown SENTRY_LINUX_BACKEND '{0}', expected crashpad, breakpad or inproc", LinuxBackend);
+			}
 			SentryLibs = new string[]
 			{
 				"libsentry.a",
@@ -145,7 +175,7 @@ public class SentryClient : ModuleRules
 				).ToArray();
 				RuntimeDependencies.Add(Path.Combine(SentryPlatform, "bin", "crashpad_handler"));
 			}
-			else
+			else if (LinuxBackend == "breakpad")
 			{
 				SentryLibs = SentryLibs.Concat(
 					new string[]
@@ -154,6 +184,7 @@ public class SentryClient : ModuleRules
 					}
 				).ToArray();
 			}
+			// the inproc backend needs nothing beyond libsentry
 		}
 		else
 		{
@@ -166,6 +197,8 @@ public class SentryClient : ModuleRules
 			PublicIncludePaths.Add(Path.Combine(SentryPlatform, "include"));
 			// sentry header file needs thef following since we use static libs
 			PublicDefinitions.Add("SENTRY_BUILD_STATIC=1");
+			// only the crashpad backend needs the path to the handler executable
+			PublicDefinitions.Add("SENTRY_BACKEND_CRASHPAD=" + (bUseCrashPad ? "1" : "0"));
 
 			foreach (string lib in SentryLibs) {
 				PublicAdditionalLibraries.Add(Path.Combine(SentryPlatform, "lib", lib));
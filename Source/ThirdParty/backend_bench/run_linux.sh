@@ -0,0 +1,34 @@
+#!/bin/bash
+# Builds the backend benchmark against each installed linux backend and runs it.
+# Build the backends first with ../build_linux.sh.
+#   run_linux.sh [iterations] [backends...]
+
+set -e
+HERE="$(cd "$(dirname "$0")" && pwd)"
+ROOT="$HERE/../../../Binaries/ThirdParty/sentry-native"
+ITERATIONS=${1:-5}
+shift || true
+BACKENDS=${@:-crashpad breakpad inproc}
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+for BACKEND in $BACKENDS; do
+	case $BACKEND in
+		crashpad) FOLDER=Linux; HANDLER="$ROOT/Linux/bin/crashpad_handler" ;;
+		breakpad) FOLDER=Linux-Breakpad; HANDLER=- ;;
+		inproc)   FOLDER=Linux-Inproc; HANDLER=- ;;
+		*) echo "unknown backend $BACKEND"; exit 1 ;;
+	esac
+	if [ ! -d "$ROOT/$FOLDER/lib" ]; then
+		echo "$BACKEND: not installed in $ROOT/$FOLDER, skipping"
+		continue
+	fi
+
+	# same compiler and runtime as the libraries, see build_linux.sh
+	clang++ -x c -O2 -DSENTRY_BUILD_STATIC=1 -I "$ROOT/$FOLDER/include" -c "$HERE/sentry_backend_bench.c" -o "$WORK/bench-$BACKEND.o"
+	clang++ -stdlib=libc++ "$WORK/bench-$BACKEND.o" -o "$WORK/bench-$BACKEND" \
+		-Wl,--start-group "$ROOT/$FOLDER"/lib/*.a -Wl,--end-group -lpthread -ldl -lz
+
+	"$WORK/bench-$BACKEND" $BACKEND "$HANDLER" "$WORK" $ITERATIONS
+done
@@ -0,0 +1,191 @@
+/*
+ * Compares the sentry-native crash backends on linux.  For each iteration a child
+ * process initializes sentry and reports its startup time and memory use, then the
+ * parent sends it SIGSEGV and measures the time until the crash report is on disk.
+ *
+ * usage: sentry_backend_bench <backend> <handler path or -> <work dir> [iterations]
+ *
+ * Built and run for every installed backend by run_linux.sh.
+ */
+#define _GNU_SOURCE
+#include <sentry.h>
+
+#include <dirent.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* VmRSS of a process in kB, or 0 */
+static long rss_kb(const char *pid)
+{
+	char path[64], line[256];
+	long kb = 0;
+	snprintf(path, sizeof(path), "/proc/%s/status", pid);
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		if (sscanf(line, "VmRSS: %ld kB", &kb) == 1)
+			break;
+	}
+	fclose(f);
+	return kb;
+}
+
+/* RSS of the crashpad_handler serving our database, which isn't our child */
+static long handler_rss_kb(const char *database)
+{
+	char needle[1024];
+	snprintf(needle, sizeof(needle), "--database=%s", database);
+	long total = 0;
+	DIR *proc = opendir("/proc");
+	struct dirent *e;
+	while (proc && (e = readdir(proc)))
+	{
+		char path[300], cmdline[4096];
+		snprintf(path, sizeof(path), "/proc/%s/cmdline", e->d_name);
+		FILE *f = fopen(path, "r");
+		if (!f)
+			continue;
+		size_t n = fread(cmdline, 1, sizeof(cmdline) - 1, f);
+		fclose(f);
+		/* arguments are separated by zeros */
+		for (size_t i = 0; i < n; i++)
+			if (cmdline[i] == 0)
+				cmdline[i] = ' ';
+		cmdline[n] = 0;
+		if (strstr(cmdline, "crashpad_handler") && strstr(cmdline, needle))
+			total += rss_kb(e->d_name);
+	}
+	if (proc)
+		closedir(proc);
+	return total;
+}
+
+/* is there a finished report below dir?  crashpad moves complete dumps to
+ * pending/, the in-process backends write an envelope into the run folder. */
+static int has_report(const char *dir, int crashpad)
+{
+	DIR *d = opendir(dir);
+	struct dirent *e;
+	int found = 0;
+	while (d && !found && (e = readdir(d)))
+	{
+		if (e->d_name[0] == '.')
+			continue;
+		char path[2048];
+		snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+		struct stat st;
+		if (stat(path, &st) != 0)
+			continue;
+		if (S_ISDIR(st.st_mode))
+			found = has_report(path, crashpad);
+		else if (crashpad)
+			found = strstr(path, "/pending/") && strstr(e->d_name, ".dmp");
+		else
+			found = strstr(e->d_name, ".envelope") != NULL;
+	}
+	if (d)
+		closedir(d);
+	return found;
+}
+
+static void run_child(const char *handler, const char *database, int out)
+{
+	double start = now_ms();
+	sentry_options_t *options = sentry_options_new();
+	sentry_options_set_dsn(options, "https://public@127.0.0.1:1/1");
+	sentry_options_set_database_path(options, database);
+	if (strcmp(handler, "-") != 0)
+		sentry_options_set_handler_path(options, handler);
+	sentry_options_set_auto_session_tracking(options, 0);
+	if (sentry_init(options) != 0)
+		_exit(2);
+	double init = now_ms() - start;
+
+	/* let the handler settle before measuring memory */
+	sleep(1);
+	char self[32];
+	snprintf(self, sizeof(self), "%d", getpid());
+	dprintf(out, "%.2f %ld %ld\n", init, rss_kb(self), handler_rss_kb(database));
+	close(out);
+	for (;;)
+		pause();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 4)
+	{
+		fprintf(stderr, "usage: %s <backend> <handler path or -> <work dir> [iterations]\n", argv[0]);
+		return 1;
+	}
+	const char *backend = argv[1];
+	const int crashpad = strcmp(backend, "crashpad") == 0;
+	const int iterations = argc > 4 ? atoi(argv[4]) : 5;
+
+	printf("%-10s %10s %10s %12s %14s\n", "backend", "init ms", "rss kB", "handler kB", "crash->disk ms");
+	for (int i = 0; i < iterations; i++)
+	{
+		char database[1024];
+		snprintf(database, sizeof(database), "%s/db-%s-XXXXXX", argv[3], backend);
+		if (!mkdtemp(database))
+		{
+			perror("mkdtemp");
+			return 1;
+		}
+
+		int fds[2];
+		if (pipe(fds) != 0)
+			return 1;
+		pid_t child = fork();
+		if (child == 0)
+		{
+			close(fds[0]);
+			run_child(argv[2], database, fds[1]);
+		}
+		close(fds[1]);
+
+		double init = 0;
+		long rss = 0, handler = 0;
+		FILE *in = fdopen(fds[0], "r");
+		if (fscanf(in, "%lf %ld %ld", &init, &rss, &handler) != 3)
+		{
+			fprintf(stderr, "%s: child failed to initialize\n", backend);
+			waitpid(child, NULL, 0);
+			return 1;
+		}
+		fclose(in);
+
+		double crash = now_ms();
+		kill(child, SIGSEGV);
+		double report = -1;
+		while (now_ms() - crash < 30000)
+		{
+			if (has_report(database, crashpad))
+			{
+				report = now_ms() - crash;
+				break;
+			}
+			usleep(1000);
+		}
+		waitpid(child, NULL, 0);
+
+		printf("%-10s %10.2f %10ld %12ld %14.1f\n", backend, init, rss, handler, report);
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -1,13 +1,28 @@
 #!/bin/bash
+# Builds the linux binaries.  See the README.md in the root for details.
+# Pass the backends to build as arguments, default is all of them:
+#   build_linux.sh [crashpad] [breakpad] [inproc]
 
 set -e
+BACKENDS=${@:-crashpad breakpad inproc}
+
 pushd "$(dirname "$0")/sentry-native"
-rm -rf build-linux
-cmake -B build-linux -DCMAKE_BUILD_TYPE=RelWithDebInfo -DBUILD_SHARED_LIBS=OFF -DSENTRY_TRANSPORT=none  \
-       -DSENTRY_BACKEND=crashpad \
-       -DCMAKE_C_COMPILER=clang -DCMAKE_CXX_COMPILER="clang++" \
-       -DCMAKE_CXX_FLAGS="-stdlib=libc++" -DCMAKE_EXE_LINKER_FLAGS="-stdlib=libc++"
-
-cmake --build build-linux --config RelWithDebInfo --parallel
-cmake --install build-linux --prefix ../../../Binaries/ThirdParty/sentry-native/Linux --config RelWithDebInfo
+for BACKEND in $BACKENDS; do
+	# install folder, must match SentryClient.Build.cs
+	case $BACKEND in
+		crashpad) FOLDER=Linux ;;
+		breakpad) FOLDER=Linux-Breakpad ;;
+		inproc)   FOLDER=Linux-Inproc ;;
+		*) echo "unknown backend $BACKEND"; exit 1 ;;
+	esac
+
+	rm -rf build-linux-$BACKEND
+	cmake -B build-linux-$BACKEND -DCMAKE_BUILD_TYPE=RelWithDebInfo -DBUILD_SHARED_LIBS=OFF -DSENTRY_TRANSPORT=none  \
+	       -DSENTRY_BACKEND=$BACKEND \
+	       -DCMAKE_C_COMPILER=clang -DCMAKE_CXX_COMPILER="clang++" \
+	       -DCMAKE_CXX_FLAGS="-stdlib=libc++" -DCMAKE_EXE_LINKER_FLAGS="-stdlib=libc++"
+
+	cmake --build build-linux-$BACKEND --config RelWithDebInfo --parallel
+	cmake --install build-linux-$BACKEND --prefix ../../../Binaries/ThirdParty/sentry-native/$FOLDER --config RelWithDebInfo
+done
 popd